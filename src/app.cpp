@@ -1,8 +1,20 @@
+#include <chrono>
+#include <cmath>     // ceil
+#include <cstdio>    // fflush, fprintf, printf
+#include <exception>
+#include <memory>    // unique_ptr
+#include <string>
+
 #include <wx/app.h>
+#include <wx/cmdline.h>  // wxCmdLineParser
 #include <wx/fileconf.h> // wxFileConfig
 #include <wx/log.h>      // ...
 
 #include "main_frame.hpp"
+#include "movie.hpp"
+#include "packed_movie.hpp"
+#include "synthetic_source.hpp"
+#include "tracker.hpp"
 
 class App : public wxApp
 {
@@ -15,7 +27,45 @@ class App : public wxApp
    MainFrame* mainFrame;
 };
 
-IMPLEMENT_APP(App)
+// Runs the modes that show no windows.  Unlike App, it doesn't initialise the GUI
+// toolkit, so it needs no display (wxGTK connects to one before App::OnInit()).
+class ConsoleApp : public wxAppConsole
+{
+   public:
+
+   // true if the command line asks for one of these modes, or for help on them
+   static bool isWanted(int argc, char** argv);
+
+   virtual int OnRun();
+   virtual void OnInitCmdLine(wxCmdLineParser&);
+   virtual bool OnCmdLineParsed(wxCmdLineParser&);
+
+   private:
+
+   // Convert a directory of bitmaps to a packed movie.
+   int pack();
+
+   // Time decoding and tracking a SyntheticSource and check the tracks against where its
+   // blobs are known to be; needs no data on disk.
+   int benchmark();
+
+   // set by command line options
+   wxString packFileName; // if not empty, run pack()
+   wxString packDir, packRegEx;
+   bool packCompressed;
+   bool runBenchmark; // if true, run benchmark()
+};
+
+IMPLEMENT_APP_NO_MAIN(App)
+
+int main(int argc, char** argv)
+{
+   // wxEntry() only creates an App if there is no application object yet.
+   if (ConsoleApp::isWanted(argc, argv)) {
+      wxApp::SetInstance(new ConsoleApp);
+   }
+   return wxEntry(argc, argv);
+}
 
 bool App::OnInit()
 {
@@ -51,3 +101,145 @@ bool App::OnInit()
 
    return true;
 }
+
+bool ConsoleApp::isWanted(int argc, char** argv)
+{
+   for (int i = 1; i < argc; ++i)
+   {
+      const std::string argument = argv[i];
+      if (argument.compare(0, 6, "--pack") == 0 || argument == "--benchmark" ||
+          argument == "--help" || argument == "-h")
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+int ConsoleApp::OnRun()
+{
+   if (!packFileName.empty()) {
+      return pack();
+   }
+   if (runBenchmark) {
+      return benchmark();
+   }
+   wxLogError("Give --pack or --benchmark; run without options to start the GUI.");
+   return 1;
+}
+
+void ConsoleApp::OnInitCmdLine(wxCmdLineParser& parser)
+{
+   wxAppConsole::OnInitCmdLine(parser);
+
+   parser.SetLogo("Without options, TrackHack starts its GUI.  These modes show no "
+      "windows and need no display.");
+
+   parser.AddOption("", "pack", "write the movie given by --dir and --regex to this "
+      "packed movie file and exit");
+   parser.AddOption("", "dir", "directory of the movie to pack");
+   parser.AddOption("", "regex", "regular expression matching the file names of the "
+      "frames to pack (default: all .bmp files)");
+   parser.AddSwitch("", "compress", "PackBits-compress frames where it saves space");
+   parser.AddSwitch("", "benchmark", "time decoding and tracking a synthetic movie, "
+      "check the tracks and exit");
+}
+
+bool ConsoleApp::OnCmdLineParsed(wxCmdLineParser& parser)
+{
+   if (!wxAppConsole::OnCmdLineParsed(parser)) {
+      return false;
+   }
+
+   packCompressed = parser.Found("compress");
+   runBenchmark = parser.Found("benchmark");
+   if (parser.Found("pack", &packFileName))
+   {
+      if (!parser.Found("dir", &packDir)) {
+         wxLogError("--pack requires --dir.");
+         return false;
+      }
+      if (!parser.Found("regex", &packRegEx)) {
+         packRegEx = ".*\\.bmp";
+      }
+   }
+   return true;
+}
+
+int ConsoleApp::pack()
+{
+   try {
+      Movie movie{packDir.ToStdString(), packRegEx.ToStdString()};
+      if (!movie.getSize()) {
+         std::fprintf(stderr, "No frames found.\n");
+         return 1;
+      }
+
+      packMovie(movie, packFileName.ToStdString(), packCompressed,
+         [&](std::size_t written) {
+            std::printf("\r%zu/%zu", written, movie.getSize());
+            std::fflush(stdout);
+            return true;
+         });
+      std::printf("\n");
+   }
+   catch (const std::exception& exception) {
+      std::fprintf(stderr, "%s\n", exception.what());
+      return 1;
+   }
+   return 0;
+}
+
+int ConsoleApp::benchmark()
+{
+   typedef std::chrono::steady_clock Clock;
+   auto secondsSince = [](Clock::time_point start) {
+      return std::chrono::duration<double>(Clock::now() - start).count();
+   };
+
+   try {
+      const SyntheticSource::Parameters parameters{};
+      SyntheticSource* source = new SyntheticSource{parameters}; // owned by movie
+      Movie movie{std::unique_ptr<FrameSource>{source}};
+      const std::size_t frameCount = movie.getSize();
+
+      Clock::time_point start = Clock::now();
+      for (std::size_t i = 0; i < frameCount; ++i) {
+         movie.getBitmap(i);
+      }
+      double seconds = secondsSince(start);
+      std::printf("decoding: %zu frames of %zux%zu in %.3f s (%.0f frames/s)\n",
+         frameCount, parameters.width, parameters.height, seconds, frameCount / seconds);
+
+      // Start each blob's track at its true position in the first frame.
+      const unsigned speedCap = unsigned(std::ceil(parameters.speed)) + 1;
+      Tracker tracker;
+      std::size_t lost = 0;
+      start = Clock::now();
+      for (unsigned blob = 0; blob < parameters.blobCount; ++blob)
+      {
+         Trackee trackee{speedCap, frameCount};
+         trackee.setPoint(0, source->getPosition(blob, 0));
+         tracker.track(trackee, movie);
+
+         auto track = trackee.getTrack().lock();
+         for (std::size_t i = 0; i < frameCount; ++i)
+         {
+            const Point point = (*track)[i], truth = source->getPosition(blob, i);
+            const double dx = point.x - truth.x, dy = point.y - truth.y;
+            if (dx * dx + dy * dy > parameters.radius * parameters.radius) ++lost;
+         }
+      }
+      seconds = secondsSince(start);
+      std::printf("tracking: %u blobs over %zu frames in %.3f s (%.0f points/s)\n",
+         parameters.blobCount, frameCount, seconds,
+         parameters.blobCount * frameCount / seconds);
+      std::printf("%zu of %zu points farther from the truth than a blob's radius\n",
+         lost, parameters.blobCount * frameCount);
+   }
+   catch (const std::exception& exception) {
+      std::fprintf(stderr, "%s\n", exception.what());
+      return 1;
+   }
+   return 0;
+}
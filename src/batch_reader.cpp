@@ -0,0 +1,527 @@
+#include <algorithm> // min
+#include <cerrno>
+#include <cstdint>   // uint64_t
+#include <exception> // exception_ptr, rethrow_exception
+#include <fstream>   // ifstream
+#include <memory>    // shared_ptr, unique_ptr
+#include <system_error>
+
+#ifdef __linux__
+  #include <fcntl.h>         // AT_FDCWD, O_RDONLY
+  #include <linux/io_uring.h>
+  #include <sys/mman.h>      // mmap(), munmap()
+  #include <sys/stat.h>      // fstat()
+  #include <sys/syscall.h>   // __NR_io_uring_*
+  #include <unistd.h>        // close(), syscall()
+#endif
+
+#include "batch_reader.hpp"
+
+namespace {
+   struct File
+   {
+      std::unique_ptr<Byte[]> data;
+      std::size_t size = 0, done = 0;
+      bool failed = false;
+   };
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+   // The submission and completion queues of an io_uring, used without liburing.  Every
+   // file takes one operation at a time: it is opened, then read (in several parts if the
+   // kernel returns short reads), then closed.
+   class Ring
+   {
+      public:
+
+      // Throws std::system_error if io_uring isn't available or lacks an operation.
+      Ring();
+
+      Ring(const Ring&) = delete;
+      Ring& operator=(const Ring&) = delete;
+
+      ~Ring();
+
+      void read(const std::vector<std::string>& fileNames,
+                const BatchReader::Handler&);
+
+      private:
+
+      static constexpr unsigned entries = 64;
+      static constexpr std::size_t depth = 32; // files in flight; one operation each
+
+      enum Operation : std::uint64_t { opening, reading };
+
+      io_uring_sqe& push();
+      void submit(bool wait); // wait for at least one completion
+      template<class Function> void reap(Function);
+
+      void pushRead(std::size_t file, File&, int fd);
+
+      // Take back the operations not submitted yet and wait for the rest, closing the
+      // files they opened, so the kernel doesn't write into buffers that are about to go.
+      void drain(std::size_t& inFlight);
+
+      int fd;
+      void* sqRing;
+      void* cqRing;
+      io_uring_sqe* sqes;
+      std::size_t sqRingSize, cqRingSize;
+
+      unsigned *sqHead, *sqTail, *sqArray, sqMask;
+      unsigned *cqHead, *cqTail, cqMask;
+      io_uring_cqe* cqes;
+
+      unsigned toSubmit;
+   };
+
+   constexpr unsigned Ring::entries;
+   constexpr std::size_t Ring::depth;
+
+   Ring::Ring() : fd{-1}, sqRing{MAP_FAILED}, cqRing{MAP_FAILED}, toSubmit{0}
+   {
+      io_uring_params params{};
+      fd = int(syscall(__NR_io_uring_setup, entries, &params));
+      if (fd < 0) {
+         throw std::system_error{errno, std::generic_category(), "io_uring_setup"};
+      }
+
+      try
+      {
+         // Opening and reading by io_uring arrived in Linux 5.6.
+         const std::size_t probeSize =
+            sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+         std::unique_ptr<Byte[]> probeBuffer{new Byte[probeSize]()};
+         auto probe = reinterpret_cast<io_uring_probe*>(probeBuffer.get());
+         if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) < 0 ||
+             probe->last_op < IORING_OP_READ ||
+             !(probe->ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED) ||
+             !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED))
+         {
+            throw std::system_error{ENOSYS, std::generic_category(), "io_uring probe"};
+         }
+
+         sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+         cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+         if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+         }
+
+         sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+         if (sqRing == MAP_FAILED) {
+            throw std::system_error{errno, std::generic_category(), "mmap"};
+         }
+         cqRing = params.features & IORING_FEAT_SINGLE_MMAP ? sqRing :
+            mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                 fd, IORING_OFF_CQ_RING);
+         if (cqRing == MAP_FAILED) {
+            throw std::system_error{errno, std::generic_category(), "mmap"};
+         }
+         void* sqesMap = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe),
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+         if (sqesMap == MAP_FAILED) {
+            throw std::system_error{errno, std::generic_category(), "mmap"};
+         }
+         sqes = static_cast<io_uring_sqe*>(sqesMap);
+      }
+      catch (...)
+      {
+         if (cqRing != MAP_FAILED && cqRing != sqRing) munmap(cqRing, cqRingSize);
+         if (sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+         close(fd);
+         throw;
+      }
+
+      auto sq = static_cast<char*>(sqRing);
+      sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+      sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+      sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+      sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+      auto cq = static_cast<char*>(cqRing);
+      cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+      cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+      cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+      cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+   }
+
+   Ring::~Ring()
+   {
+      munmap(sqes, (sqMask + 1) * sizeof(io_uring_sqe));
+      if (cqRing != sqRing) munmap(cqRing, cqRingSize);
+      munmap(sqRing, sqRingSize);
+      close(fd);
+   }
+
+   void Ring::read(const std::vector<std::string>& fileNames,
+      const BatchReader::Handler& handler)
+   {
+      std::vector<File> files(fileNames.size());
+      std::size_t admitted = 0, inFlight = 0, handled = 0;
+      std::vector<std::size_t> completed;
+      std::exception_ptr exception;
+
+      try
+      {
+         while (inFlight || (!exception && handled < files.size()))
+         {
+            for (; !exception && admitted < files.size() && inFlight < depth; ++admitted)
+            {
+               io_uring_sqe& sqe = push();
+               sqe.opcode = IORING_OP_OPENAT;
+               sqe.fd = AT_FDCWD;
+               sqe.addr = reinterpret_cast<std::uint64_t>(fileNames[admitted].c_str());
+               sqe.open_flags = O_RDONLY | O_CLOEXEC;
+               sqe.user_data = admitted << 1 | opening;
+               ++inFlight;
+            }
+
+            submit(inFlight > 0);
+
+            reap([&](std::uint64_t userData, int result) {
+                  const std::size_t i = (userData & 0xffffffff) >> 1;
+                  File& file = files[i];
+
+                  if (Operation(userData & 1) == opening)
+                  {
+                     struct stat status;
+                     if (result < 0 || fstat(result, &status) || status.st_size <= 0)
+                     {
+                        if (result >= 0) close(result);
+                        file.failed = true;
+                        --inFlight;
+                        completed.push_back(i);
+                        return;
+                     }
+                     file.size = std::size_t(status.st_size);
+                     try {
+                        file.data.reset(new Byte[file.size]);
+                     }
+                     catch (...) {
+                        close(result);
+                        --inFlight;
+                        throw;
+                     }
+                     pushRead(i, file, result);
+                     return;
+                  }
+
+                  const int fd = int(userData >> 32);
+                  if (result > 0) file.done += std::size_t(result);
+                  if (result > 0 && file.done < file.size) {
+                     pushRead(i, file, fd); // a short read; go on
+                     return;
+                  }
+
+                  // The file may have been truncated since it was opened.
+                  close(fd);
+                  file.failed = result < 0 || !file.done;
+                  file.size = file.done;
+                  --inFlight;
+                  completed.push_back(i);
+               }
+            );
+
+            // Let the kernel start on the new reads before the files are processed.
+            if (toSubmit) submit(false);
+
+            for (std::size_t i : completed)
+            {
+               File& file = files[i];
+               if (!exception)
+               {
+                  try {
+                     handler(i, file.failed ? nullptr : file.data.get(), file.size);
+                  }
+                  catch (...) {
+                     exception = std::current_exception();
+                  }
+               }
+               file.data.reset();
+               ++handled;
+            }
+            completed.clear();
+         }
+      }
+      catch (...)
+      {
+         // e.g. io_uring_enter failed
+         drain(inFlight);
+         throw;
+      }
+
+      if (exception) std::rethrow_exception(exception);
+   }
+
+   io_uring_sqe& Ring::push()
+   {
+      const unsigned tail = *sqTail;
+      const unsigned index = tail & sqMask;
+      io_uring_sqe& sqe = sqes[index];
+      sqe = io_uring_sqe{};
+      sqArray[index] = index;
+      __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+      ++toSubmit;
+      return sqe;
+   }
+
+   void Ring::submit(bool wait)
+   {
+      for (;;)
+      {
+         const long result = syscall(__NR_io_uring_enter, fd, toSubmit, wait ? 1 : 0,
+            wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+         if (result >= 0)
+         {
+            toSubmit -= unsigned(result);
+            if (!toSubmit) return;
+            wait = false;
+         }
+         else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            throw std::system_error{errno, std::generic_category(), "io_uring_enter"};
+         }
+      }
+   }
+
+   // Each completion is consumed before function is called, so none is seen twice if it
+   // throws.
+   template<class Function>
+   void Ring::reap(Function function)
+   {
+      unsigned head = *cqHead;
+      const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+      while (head != tail)
+      {
+         const io_uring_cqe cqe = cqes[head & cqMask];
+         __atomic_store_n(cqHead, ++head, __ATOMIC_RELEASE);
+         function(cqe.user_data, cqe.res);
+      }
+   }
+
+   // The file descriptor goes into the upper half of the user data.
+   void Ring::pushRead(std::size_t i, File& file, int fd)
+   {
+      io_uring_sqe& sqe = push();
+      sqe.opcode = IORING_OP_READ;
+      sqe.fd = fd;
+      sqe.addr = reinterpret_cast<std::uint64_t>(file.data.get() + file.done);
+      sqe.len = unsigned(std::min<std::size_t>(file.size - file.done, 1u << 30));
+      sqe.off = file.done;
+      sqe.user_data = std::uint64_t(fd) << 32 | i << 1 | reading;
+   }
+
+   void Ring::drain(std::size_t& inFlight)
+   {
+      // The entries not submitted are the last ones; a read among them holds its file.
+      for (; toSubmit; --toSubmit)
+      {
+         const unsigned tail = *sqTail - 1;
+         const io_uring_sqe& sqe = sqes[tail & sqMask];
+         if (sqe.opcode == IORING_OP_READ) close(sqe.fd);
+         __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+         --inFlight;
+      }
+
+      while (inFlight)
+      {
+         try {
+            submit(true);
+         }
+         catch (const std::system_error&) {
+            // Completions are posted without entering the kernel, too; look again soon.
+            boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+         }
+         reap([&](std::uint64_t userData, int result) {
+               if (Operation(userData & 1) == reading) {
+                  close(int(userData >> 32));
+               }
+               else if (result >= 0) {
+                  close(result);
+               }
+               --inFlight;
+            }
+         );
+      }
+   }
+
+   // Rings are set up on first use by each thread; nullptr if that failed.
+   Ring* threadRing()
+   {
+      thread_local bool tried = false;
+      thread_local std::unique_ptr<Ring> ring;
+      if (!tried)
+      {
+         tried = true;
+         try {
+            ring.reset(new Ring);
+         }
+         catch (const std::exception&) {
+            // not supported by the kernel, or disabled; use the pool
+         }
+      }
+      return ring.get();
+   }
+#endif
+
+   bool readFile(const std::string& fileName, File& file)
+   {
+      std::ifstream iStream{fileName, std::ios::binary | std::ios::ate};
+      if (!iStream) return false;
+
+      const std::streamoff size = iStream.tellg();
+      if (size <= 0) return false;
+
+      file.size = std::size_t(size);
+      file.data.reset(new Byte[file.size]);
+      iStream.seekg(0);
+      return bool(iStream.read(reinterpret_cast<char*>(file.data.get()), size));
+   }
+}
+
+BatchReader& BatchReader::get()
+{
+   static BatchReader reader;
+   return reader;
+}
+
+BatchReader::BatchReader() :
+   ioUring{true}, threadCount{8}, jobs{}, terminate{false} {}
+
+BatchReader::~BatchReader()
+{
+   {
+      boost::lock_guard<boost::mutex> lock{mutex};
+      terminate = true;
+      jobs.clear();
+   }
+   queued.notify_all();
+
+   for (auto& thread : threads) {
+      thread.join();
+   }
+}
+
+void BatchReader::read(const std::vector<std::string>& fileNames, const Handler& handler)
+{
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+   if (usesIoUring()) {
+      threadRing()->read(fileNames, handler);
+      return;
+   }
+#endif
+   readWithPool(fileNames, handler);
+}
+
+void BatchReader::setIoUring(bool enabled)
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   ioUring = enabled;
+}
+
+bool BatchReader::usesIoUring()
+{
+   {
+      boost::lock_guard<boost::mutex> lock{mutex};
+      if (!ioUring) return false;
+   }
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+   return threadRing() != nullptr;
+#else
+   return false;
+#endif
+}
+
+void BatchReader::setThreadCount(unsigned count)
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   threadCount = count ? count : 1;
+}
+
+void BatchReader::readWithPool(const std::vector<std::string>& fileNames,
+   const Handler& handler)
+{
+   // Shared with the jobs, which may still be notifying when this call returns.
+   struct Batch
+   {
+      std::vector<File> files;
+      std::deque<std::size_t> completed;
+      bool cancelled = false; // The files not being read yet are skipped.
+      boost::mutex mutex;
+      boost::condition_variable read; // signalled when a file was read
+   };
+   auto batch = std::make_shared<Batch>();
+   batch->files.resize(fileNames.size());
+
+   {
+      boost::lock_guard<boost::mutex> lock{mutex};
+      while (threads.size() < threadCount) {
+         threads.emplace_back(&BatchReader::work, this);
+      }
+      for (std::size_t i = 0; i < fileNames.size(); ++i)
+      {
+         jobs.emplace_back([batch, i, fileName = fileNames[i]]() {
+               File& file = batch->files[i];
+               bool cancelled;
+               {
+                  boost::lock_guard<boost::mutex> lock{batch->mutex};
+                  cancelled = batch->cancelled;
+               }
+               file.failed = cancelled || !readFile(fileName, file);
+               {
+                  boost::lock_guard<boost::mutex> lock{batch->mutex};
+                  batch->completed.push_back(i);
+               }
+               batch->read.notify_one();
+            }
+         );
+      }
+   }
+   queued.notify_all();
+
+   // Like the io_uring: once the handler threw, the files still queued are skipped and
+   // the ones being read are waited for, but not handled.
+   std::exception_ptr exception;
+   for (std::size_t completed = 0; completed < fileNames.size(); ++completed)
+   {
+      std::size_t i;
+      {
+         boost::unique_lock<boost::mutex> lock{batch->mutex};
+         batch->read.wait(lock, [&batch]{ return !batch->completed.empty(); });
+         i = batch->completed.front();
+         batch->completed.pop_front();
+      }
+
+      File& file = batch->files[i];
+      if (!exception)
+      {
+         try {
+            handler(i, file.failed ? nullptr : file.data.get(), file.size);
+         }
+         catch (...)
+         {
+            exception = std::current_exception();
+            boost::lock_guard<boost::mutex> lock{batch->mutex};
+            batch->cancelled = true;
+         }
+      }
+      file.data.reset();
+   }
+   if (exception) std::rethrow_exception(exception);
+}
+
+void BatchReader::work()
+{
+   for (;;)
+   {
+      std::function<void()> job;
+      {
+         boost::unique_lock<boost::mutex> lock{mutex};
+         queued.wait(lock, [this]{ return terminate || !jobs.empty(); });
+         if (terminate) return;
+
+         job = std::move(jobs.front());
+         jobs.pop_front();
+      }
+      job();
+   }
+}
@@ -0,0 +1,70 @@
+#ifndef BATCH_READER_H
+#define BATCH_READER_H
+
+#include <cstddef>    // size_t
+#include <deque>
+#include <functional> // function
+#include <string>
+#include <vector>
+
+#define BOOST_THREAD_USE_LIB
+#include <boost/thread.hpp> // thread, mutex, condition_variable
+
+#include "bitmap.hpp" // Byte
+
+// Reads whole files in batches, so the latency of reading a small file is paid about once
+// per batch instead of once per file.  On Linux, the reads of a batch are submitted
+// together through an io_uring (one per calling thread); where that isn't available or
+// is disabled, a pool of threads reads the files.  Either way, files that were read are
+// handed to the caller while the rest are still being read.  All members are thread-safe.
+class BatchReader
+{
+   public:
+
+   // Called with the position of the file in the batch and its contents; data is nullptr
+   // if the file couldn't be read.  The data is freed when the handler returns.
+   typedef std::function<void(std::size_t, const Byte* data, std::size_t size)> Handler;
+
+   static BatchReader& get();
+
+   BatchReader(const BatchReader&) = delete;
+   BatchReader& operator=(const BatchReader&) = delete;
+
+   // Joins the threads of the pool.
+   ~BatchReader();
+
+   // Read the files and call handler for each of them on the calling thread, in the order
+   // the reads complete.  Returns once all files were handled.  If handler throws, no
+   // more reads are started, and the ones in progress are completed (but not handled)
+   // before it is rethrown.  The same goes for a std::system_error from io_uring.
+   void read(const std::vector<std::string>& fileNames, const Handler&);
+
+   // Use io_uring where available (the default).  Otherwise, or if it isn't available,
+   // the pool's threads read the files.
+   void setIoUring(bool);
+
+   // true if reads of the calling thread go through an io_uring
+   bool usesIoUring();
+
+   // of the pool; takes effect when the pool's threads are started, i.e. on the first
+   // read without io_uring
+   void setThreadCount(unsigned);
+
+   private:
+
+   BatchReader();
+
+   void readWithPool(const std::vector<std::string>& fileNames, const Handler&);
+   void work();
+
+   bool ioUring;
+   unsigned threadCount;
+
+   std::deque<std::function<void()>> jobs;
+   bool terminate;
+   boost::mutex mutex;
+   boost::condition_variable queued; // signalled when jobs get added
+   std::vector<boost::thread> threads;
+};
+
+#endif //BATCH_READER_H
@@ -1,17 +1,30 @@
 #include "bitmap.hpp"
+#include "bitmap_pool.hpp"
 
-Bitmap::Bitmap(std::size_t width, std::size_t height) : width{width}, height{height}
+Bitmap::Bitmap(std::size_t width, std::size_t height) :
+   width{width}, height{height}, first{0}, last{height}
 {
-   const auto size = width * height;
-   pixels = new Byte[size];
+   pixels = BitmapPool::get().allocate(width * height);
 }
 
+Bitmap::Bitmap(std::size_t width, std::size_t height, std::size_t first,
+   std::size_t last) :
+   width{width}, height{height}, first{first}, last{last}
+{
+   pixels = BitmapPool::get().allocate(width * (last - first));
+}
+
+Bitmap::Bitmap(std::size_t width, std::size_t height, Byte* pixels,
+   std::shared_ptr<const void> owner) :
+   width{width}, height{height}, first{0}, last{height}, pixels{pixels},
+   owner{std::move(owner)} {}
+
 Bitmap::~Bitmap()
 {
-   delete[] pixels;
+   if (!owner) BitmapPool::get().release(pixels, width * (last - first));
 }
 
 unsigned char* Bitmap::operator[](std::size_t row) const
 {
-   return pixels + row * width;
+   return pixels + (row - first) * width;
 }
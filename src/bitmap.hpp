@@ -2,6 +2,7 @@
 #define BITMAP_H
 
 #include <cstddef> // size_t
+#include <memory>  // shared_ptr
 
 typedef unsigned char Byte;
 
@@ -9,15 +10,31 @@ struct Bitmap
 {
    Bitmap() = default;
 
+   // The pixels come from the BitmapPool.
    Bitmap(std::size_t width, std::size_t height);
 
+   // A band of rows first to last (exclusive) of a frame of the given size; only those
+   // rows have pixels.  The pixels come from the BitmapPool.
+   Bitmap(std::size_t width, std::size_t height, std::size_t first, std::size_t last);
+
+   // Use pixels owned by something else, e.g. a memory-mapped file; owner is kept alive
+   // as long as the Bitmap and pixels aren't deleted.
+   Bitmap(std::size_t width, std::size_t height, Byte* pixels,
+          std::shared_ptr<const void> owner);
+
+   Bitmap(const Bitmap&) = delete;
+   Bitmap& operator=(const Bitmap&) = delete;
+
    ~Bitmap();
 
-   Byte* operator[](std::size_t) const;
+   Byte* operator[](std::size_t) const; // only for rows first to last
+
+   std::size_t width = 0, height = 0;
+   std::size_t first = 0, last = 0; // the rows that have pixels; all but in bands
 
-   std::size_t width, height;
+   Byte* pixels = nullptr; // of row first
 
-   Byte* pixels;
+   std::shared_ptr<const void> owner; // nullptr if the pixels belong to this Bitmap
 };
 
 #endif //BITMAP_H
@@ -0,0 +1,155 @@
+#include <cstdlib> // free(), posix_memalign()
+#include <new>     // bad_alloc
+
+#ifdef _WIN32
+  #include <malloc.h>   // _aligned_malloc(), _aligned_free()
+#else
+  #include <sys/mman.h> // madvise()
+#endif
+
+#include "bitmap_pool.hpp"
+
+constexpr std::size_t BitmapPool::alignment;
+constexpr std::size_t BitmapPool::hugePageSize;
+
+BitmapPool& BitmapPool::get()
+{
+   static BitmapPool pool;
+   return pool;
+}
+
+BitmapPool::BitmapPool() :
+   freeBuffers{}, freeBytes{0}, limit{std::size_t{256} << 20}, hugePages{true},
+   allocations{0}, reuses{0}, live{0} {}
+
+BitmapPool::~BitmapPool()
+{
+   for (auto& sizeBuffers : freeBuffers) {
+      for (Byte* buffer : sizeBuffers.second) freeAligned(buffer);
+   }
+}
+
+Byte* BitmapPool::allocate(std::size_t size)
+{
+   const std::size_t rounded = roundUp(size ? size : 1, alignment);
+   {
+      boost::lock_guard<boost::mutex> lock{mutex};
+      ++live;
+
+      auto it = freeBuffers.find(rounded);
+      if (it != freeBuffers.end() && !it->second.empty())
+      {
+         Byte* buffer = it->second.back();
+         it->second.pop_back();
+         freeBytes -= rounded;
+         ++reuses;
+         return buffer;
+      }
+      ++allocations;
+   }
+
+   try {
+      return allocateAligned(rounded);
+   }
+   catch (...) {
+      boost::lock_guard<boost::mutex> lock{mutex};
+      --live;
+      --allocations;
+      throw;
+   }
+}
+
+void BitmapPool::release(Byte* buffer, std::size_t size)
+{
+   if (!buffer) return;
+
+   const std::size_t rounded = roundUp(size ? size : 1, alignment);
+   {
+      boost::lock_guard<boost::mutex> lock{mutex};
+      --live;
+      if (freeBytes + rounded <= limit)
+      {
+         freeBuffers[rounded].push_back(buffer);
+         freeBytes += rounded;
+         return;
+      }
+   }
+   freeAligned(buffer);
+}
+
+void BitmapPool::setLimit(std::size_t bytes)
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   limit = bytes;
+   trim();
+}
+
+void BitmapPool::setHugePages(bool enable)
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   hugePages = enable;
+}
+
+BitmapPool::Stats BitmapPool::getStats() const
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+
+   std::size_t count = 0;
+   for (const auto& sizeBuffers : freeBuffers) {
+      count += sizeBuffers.second.size();
+   }
+   return Stats{allocations, reuses, live, count, freeBytes};
+}
+
+std::size_t BitmapPool::roundUp(std::size_t size, std::size_t multiple)
+{
+   return (size + multiple - 1) / multiple * multiple;
+}
+
+Byte* BitmapPool::allocateAligned(std::size_t size)
+{
+   bool huge;
+   {
+      boost::lock_guard<boost::mutex> lock{mutex};
+      huge = hugePages && size >= hugePageSize;
+   }
+
+   void* buffer = nullptr;
+   #ifdef _WIN32
+     (void)huge; // Large pages need a privilege most users don't have.
+     buffer = ::_aligned_malloc(size, alignment);
+     if (!buffer) throw std::bad_alloc{};
+   #else
+     if (::posix_memalign(&buffer, huge ? hugePageSize : alignment, size)) {
+        throw std::bad_alloc{};
+     }
+     #ifdef MADV_HUGEPAGE
+       if (huge) ::madvise(buffer, size / hugePageSize * hugePageSize, MADV_HUGEPAGE);
+     #endif
+   #endif
+
+   return static_cast<Byte*>(buffer);
+}
+
+void BitmapPool::freeAligned(Byte* buffer)
+{
+   #ifdef _WIN32
+     ::_aligned_free(buffer);
+   #else
+     std::free(buffer);
+   #endif
+}
+
+void BitmapPool::trim()
+{
+   for (auto& sizeBuffers : freeBuffers)
+   {
+      auto& buffers = sizeBuffers.second;
+      while (freeBytes > limit && !buffers.empty())
+      {
+         freeAligned(buffers.back());
+         buffers.pop_back();
+         freeBytes -= sizeBuffers.first;
+      }
+   }
+}
@@ -0,0 +1,71 @@
+#ifndef BITMAP_POOL_H
+#define BITMAP_POOL_H
+
+#include <cstddef> // size_t
+#include <unordered_map>
+#include <vector>
+
+#define BOOST_THREAD_USE_LIB
+#include <boost/thread.hpp> // mutex
+
+#include "bitmap.hpp" // Byte
+
+// Recycles pixel buffers.  All frames of a movie have the same size, so a buffer freed by
+// an evicted frame is usually just right for the next decoded one, which saves the
+// allocator's work and the page faults of touching fresh memory.  Buffers are 64-byte
+// aligned; large ones are aligned to 2 MiB and transparent huge pages are requested for
+// them (on Linux; if enabled).  At most a limited number of bytes is kept in free
+// buffers.  All members are thread-safe.
+class BitmapPool
+{
+   public:
+
+   struct Stats
+   {
+      std::size_t allocations; // buffers handed out that had to be allocated
+      std::size_t reuses;      // buffers handed out that were recycled
+      std::size_t live;        // buffers handed out and not released yet
+      std::size_t freeBuffers, freeBytes; // kept for reuse
+   };
+
+   static BitmapPool& get();
+
+   BitmapPool(const BitmapPool&) = delete;
+   BitmapPool& operator=(const BitmapPool&) = delete;
+
+   ~BitmapPool();
+
+   Byte* allocate(std::size_t size);
+   void release(Byte*, std::size_t size); // size as passed to allocate()
+
+   // Limit the bytes kept in free buffers; excess buffers are freed right away.
+   void setLimit(std::size_t bytes);
+
+   // Affects buffers allocated from now on.
+   void setHugePages(bool);
+
+   Stats getStats() const;
+
+   static constexpr std::size_t alignment = 64;
+   static constexpr std::size_t hugePageSize = std::size_t{2} << 20;
+
+   private:
+
+   BitmapPool();
+
+   static std::size_t roundUp(std::size_t size, std::size_t multiple);
+
+   Byte* allocateAligned(std::size_t size);
+   static void freeAligned(Byte*);
+
+   void trim(); // the mutex has to be held
+
+   std::unordered_map<std::size_t, std::vector<Byte*>> freeBuffers; // by rounded size
+   std::size_t freeBytes, limit;
+   bool hugePages;
+   std::size_t allocations, reuses, live;
+
+   mutable boost::mutex mutex;
+};
+
+#endif //BITMAP_POOL_H
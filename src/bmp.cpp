@@ -0,0 +1,125 @@
+#include <algorithm> // min
+#include <cstdint>   // int32_t
+#include <fstream>   // ifstream
+
+#include "bmp.hpp"
+
+namespace {
+   // little-endian
+   unsigned long read(const Byte* bytes, std::size_t size)
+   {
+      unsigned long value = 0;
+      for (std::size_t i = size; i--;) value = value << 8 | bytes[i];
+      return value;
+   }
+
+   bool readBmpInfo(std::ifstream& iStream, BmpInfo& info)
+   {
+      Byte header[54];
+      if (!iStream.read(reinterpret_cast<char*>(header), 26) ||
+          header[0] != 'B' || header[1] != 'M')
+      {
+         return false;
+      }
+
+      const unsigned long infoSize = read(header + 14, 4);
+      long width, height;
+      unsigned long compression = 0, colors = 0;
+      if (infoSize == 12) // BITMAPCOREHEADER
+      {
+         width = long(read(header + 18, 2));
+         height = long(read(header + 20, 2));
+         info.bitsPerPixel = read(header + 24, 2);
+      }
+      else if (infoSize >= 40)
+      {
+         if (!iStream.read(reinterpret_cast<char*>(header + 26), 28)) return false;
+         width = long(std::int32_t(read(header + 18, 4)));
+         height = long(std::int32_t(read(header + 22, 4)));
+         info.bitsPerPixel = read(header + 28, 2);
+         compression = read(header + 30, 4);
+         colors = read(header + 46, 4);
+      }
+      else {
+         return false;
+      }
+
+      info.topDown = height < 0;
+      if (info.topDown) height = -height;
+      if (width <= 0 || height <= 0) return false;
+
+      info.width = width;
+      info.height = height;
+      info.pixelOffset = read(header + 10, 4);
+      info.stride = (info.bitsPerPixel * info.width + 31) / 32 * 4;
+      info.uncompressed = compression == 0 && (info.bitsPerPixel == 8 ||
+         info.bitsPerPixel == 24 || info.bitsPerPixel == 32);
+
+      info.palette.clear();
+      if (info.uncompressed && info.bitsPerPixel == 8)
+      {
+         // The palette follows the info header; core headers have 3-byte entries.
+         const std::size_t entrySize = infoSize == 12 ? 3 : 4;
+         if (!colors || colors > 256) colors = 256;
+         std::vector<Byte> entries(colors * entrySize);
+         iStream.seekg(14 + infoSize);
+         if (!iStream.read(reinterpret_cast<char*>(entries.data()), entries.size())) {
+            return false;
+         }
+         info.palette.resize(256, 0);
+         for (std::size_t i = 0; i < colors; ++i) {
+            info.palette[i] = entries[i * entrySize + 2]; // stored as BGR(A)
+         }
+      }
+      return true;
+   }
+}
+
+bool readBmpInfo(const std::string& fileName, BmpInfo& info)
+{
+   std::ifstream iStream{fileName, std::ios::binary};
+   return readBmpInfo(iStream, info);
+}
+
+std::shared_ptr<const Bitmap> readBmpRows(const std::string& fileName, std::size_t first,
+   std::size_t last)
+{
+   std::ifstream iStream{fileName, std::ios::binary};
+   BmpInfo info;
+   if (!readBmpInfo(iStream, info) || !info.uncompressed) {
+      return nullptr;
+   }
+
+   last = std::min(last, info.height);
+   first = std::min(first, last);
+   auto bitmap = std::make_shared<Bitmap>(info.width, info.height, first, last);
+   if (first == last) {
+      return bitmap;
+   }
+
+   // The band is contiguous in the file either way; bottom-up files store it reversed.
+   const std::size_t count = last - first;
+   const std::size_t firstStored = info.topDown ? first : info.height - last;
+   std::vector<Byte> rows(count * info.stride);
+   iStream.seekg(info.pixelOffset + std::uint64_t{firstStored} * info.stride);
+   if (!iStream.read(reinterpret_cast<char*>(rows.data()), rows.size())) {
+      return nullptr;
+   }
+
+   const std::size_t bytesPerPixel = info.bitsPerPixel / 8;
+   for (std::size_t i = 0; i < count; ++i)
+   {
+      const Byte* stored = &rows[i * info.stride];
+      Byte* row = (*bitmap)[info.topDown ? first + i : last - 1 - i];
+
+      if (bytesPerPixel == 1) {
+         for (std::size_t x = 0; x < info.width; ++x) row[x] = info.palette[stored[x]];
+      }
+      else {
+         for (std::size_t x = 0; x < info.width; ++x) {
+            row[x] = stored[x * bytesPerPixel + 2]; // BGR(A)
+         }
+      }
+   }
+   return bitmap;
+}
@@ -0,0 +1,35 @@
+#ifndef BMP_H
+#define BMP_H
+
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <memory>  // shared_ptr
+#include <string>
+#include <vector>
+
+#include "bitmap.hpp"
+
+// Just enough of the BMP file format to read a band of rows without decoding the whole
+// image; that works since the rows of uncompressed BMP files are stored at fixed offsets.
+
+struct BmpInfo
+{
+   std::size_t   width, height;
+   bool          topDown;       // Rows are usually stored bottom-up.
+   unsigned      bitsPerPixel;
+   bool          uncompressed;  // and with 8, 24 or 32 bits per pixel
+   std::uint64_t pixelOffset;   // of the first stored row
+   std::size_t   stride;        // bytes per stored row, including padding
+   std::vector<Byte> palette;   // the red components of the colors, if bitsPerPixel is 8
+};
+
+// Read the headers (and palette) of a BMP file.  false if it isn't one.
+bool readBmpInfo(const std::string& fileName, BmpInfo&);
+
+// Read rows first to last (exclusive) of an uncompressed BMP file into a band (see
+// Bitmap).  The red component is used as the intensity, like the full decode does.
+// nullptr if the file can't be read that way.
+std::shared_ptr<const Bitmap> readBmpRows(const std::string& fileName, std::size_t first,
+   std::size_t last);
+
+#endif //BMP_H
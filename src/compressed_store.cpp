@@ -0,0 +1,243 @@
+#include <algorithm> // find_if, min, remove_if
+#include <cstddef>   // ptrdiff_t
+#include <cstring>   // memcpy
+
+#include "compressed_store.hpp"
+#include "rice.hpp"
+
+namespace {
+   const std::size_t keyframeCacheSize = 4;
+}
+
+CompressedStore::CompressedStore(std::size_t budget, std::size_t frameCount,
+   std::size_t keyframeInterval) :
+   entries(frameCount), keyframeInterval{keyframeInterval ? keyframeInterval : 1},
+   bytes{0}, rawBytes{0}, budget{budget}, frames{0}, full{false}, keyframes{} {}
+
+std::shared_ptr<const Bitmap> CompressedStore::get(std::size_t index)
+{
+   auto entry = getEntry(index);
+   if (!entry) {
+      return nullptr;
+   }
+
+   // A delta is decoded against the keyframe it was coded relative to, even if that was
+   // dropped since.
+   std::shared_ptr<const Bitmap> keyframe;
+   if (entry->coding == delta)
+   {
+      keyframe = getKeyframe(index - index % keyframeInterval, entry->keyframe);
+      if (!keyframe) return nullptr;
+   }
+   return decode(*entry, keyframe.get());
+}
+
+bool CompressedStore::insert(std::size_t index, const Bitmap& bitmap)
+{
+   if (contains(index) || isFull()) {
+      return false;
+   }
+
+   const std::size_t width = bitmap.width, height = bitmap.height;
+   const std::size_t size = width * height;
+
+   auto entry = std::make_shared<Entry>();
+   entry->width = width;
+   entry->height = height;
+
+   // Compute the residuals: differences to the keyframe if possible, to the left (or, at
+   // the beginning of a row, upper) neighbour otherwise.
+   std::vector<Byte> residuals(size);
+   const std::size_t keyIndex = index - index % keyframeInterval;
+   std::shared_ptr<const Entry> keyEntry;
+   std::shared_ptr<const Bitmap> keyframe;
+   if (index != keyIndex && (keyEntry = getEntry(keyIndex))) {
+      keyframe = getKeyframe(keyIndex, keyEntry);
+   }
+   if (keyframe && keyframe->width == width && keyframe->height == height)
+   {
+      entry->coding = delta;
+      entry->keyframe = std::move(keyEntry);
+      for (std::size_t i = 0; i < size; ++i) {
+         residuals[i] = Byte(bitmap.pixels[i] - keyframe->pixels[i]);
+      }
+   }
+   else
+   {
+      entry->coding = intra;
+      for (std::size_t y = 0; y < height; ++y)
+      {
+         const Byte* row = bitmap[y];
+         Byte* residualRow = &residuals[y * width];
+         residualRow[0] = Byte(row[0] - (y ? bitmap[y - 1][0] : 0));
+         for (std::size_t x = 1; x < width; ++x) {
+            residualRow[x] = Byte(row[x] - row[x - 1]);
+         }
+      }
+   }
+
+   riceEncode(residuals.data(), size, entry->data);
+   if (entry->data.size() >= size)
+   {
+      entry->coding = raw;
+      entry->data.assign(bitmap.pixels, bitmap.pixels + size);
+      entry->keyframe.reset();
+   }
+   entry->data.shrink_to_fit();
+
+   boost::lock_guard<boost::mutex> lock{mutex};
+   if (index >= entries.size() || entries[index]) {
+      return false; // out of range, or another thread was faster
+   }
+   if (entry->keyframe && entries[keyIndex] != entry->keyframe) {
+      return false; // The keyframe was dropped meanwhile; the delta would be stale.
+   }
+   if (bytes + entry->data.size() > budget) {
+      full = true;
+      return false;
+   }
+   bytes += entry->data.size();
+   rawBytes += size;
+   ++frames;
+   entries[index] = std::move(entry);
+   return true;
+}
+
+bool CompressedStore::contains(std::size_t index) const
+{
+   return bool(getEntry(index));
+}
+
+void CompressedStore::drop(std::size_t index)
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   if (index >= entries.size()) {
+      return;
+   }
+
+   auto remove = [this](std::size_t i) {
+      bytes -= entries[i]->data.size();
+      rawBytes -= entries[i]->width * entries[i]->height;
+      --frames;
+      entries[i].reset();
+   };
+
+   const std::shared_ptr<const Entry> entry = entries[index];
+   if (entry) remove(index);
+   if (index % keyframeInterval) {
+      return;
+   }
+
+   for (std::size_t i = index + 1;
+        i < std::min(index + keyframeInterval, entries.size()); ++i)
+   {
+      if (entries[i] && entries[i]->coding == delta) remove(i);
+   }
+   keyframes.erase(std::remove_if(keyframes.begin(), keyframes.end(),
+      [&entry](const decltype(keyframes)::value_type& keyframe) {
+         return keyframe.first == entry;
+      }
+   ), keyframes.end());
+   full = false;
+}
+
+void CompressedStore::resize(std::size_t frameCount)
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   if (frameCount > entries.size()) entries.resize(frameCount);
+}
+
+bool CompressedStore::isFull() const
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   return full;
+}
+
+CompressedStore::Stats CompressedStore::getStats() const
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   return Stats{frames, bytes, rawBytes, budget};
+}
+
+std::shared_ptr<const CompressedStore::Entry> CompressedStore::getEntry(
+   std::size_t index) const
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   return index < entries.size() ? entries[index] : nullptr;
+}
+
+std::shared_ptr<const Bitmap> CompressedStore::getKeyframe(std::size_t index,
+   const std::shared_ptr<const Entry>& entry)
+{
+   if (!entry) {
+      return nullptr;
+   }
+
+   {
+      boost::lock_guard<boost::mutex> lock{mutex};
+      auto it = std::find_if(keyframes.begin(), keyframes.end(),
+         [&entry](const decltype(keyframes)::value_type& keyframe) {
+            return keyframe.first == entry;
+         }
+      );
+      if (it != keyframes.end())
+      {
+         auto keyframe = *it;
+         keyframes.erase(it);
+         keyframes.insert(keyframes.begin(), keyframe);
+         return keyframe.second;
+      }
+   }
+
+   // Keyframes are never delta-coded.
+   auto bitmap = decode(*entry, nullptr);
+
+   // Only keyframes still stored are kept; one dropped while it was decoded is of no
+   // use to later frames.
+   boost::lock_guard<boost::mutex> lock{mutex};
+   if (!bitmap || index >= entries.size() || entries[index] != entry) {
+      return bitmap;
+   }
+   keyframes.emplace(keyframes.begin(), entry, bitmap);
+   if (keyframes.size() > keyframeCacheSize) {
+      keyframes.pop_back();
+   }
+   return bitmap;
+}
+
+std::shared_ptr<const Bitmap> CompressedStore::decode(const Entry& entry,
+   const Bitmap* keyframe) const
+{
+   const std::size_t width = entry.width, height = entry.height;
+   const std::size_t size = width * height;
+
+   auto bitmap = std::make_shared<Bitmap>(width, height);
+   if (entry.coding == raw) {
+      std::memcpy(bitmap->pixels, entry.data.data(), size);
+      return bitmap;
+   }
+
+   // Decode the residuals right into the bitmap and undo the prediction in place.
+   if (!riceDecode(entry.data.data(), entry.data.size(), bitmap->pixels, size)) {
+      return nullptr;
+   }
+   Byte* pixels = bitmap->pixels;
+   if (entry.coding == delta)
+   {
+      for (std::size_t i = 0; i < size; ++i) {
+         pixels[i] = Byte(pixels[i] + keyframe->pixels[i]);
+      }
+   }
+   else
+   {
+      for (std::size_t y = 0; y < height; ++y)
+      {
+         Byte* row = pixels + y * width;
+         row[0] = Byte(row[0] + (y ? row[-std::ptrdiff_t(width)] : 0));
+         for (std::size_t x = 1; x < width; ++x) {
+            row[x] = Byte(row[x] + row[x - 1]);
+         }
+      }
+   }
+   return bitmap;
+}
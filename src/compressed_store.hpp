@@ -0,0 +1,98 @@
+#ifndef COMPRESSED_STORE_H
+#define COMPRESSED_STORE_H
+
+#include <cstddef> // size_t
+#include <memory>  // shared_ptr
+#include <vector>
+
+#define BOOST_THREAD_USE_LIB
+#include <boost/thread.hpp> // mutex
+
+#include "bitmap.hpp"
+
+// Holds losslessly compressed copies of frames so far more of a movie fits into memory
+// than as Bitmaps.  Every keyframeInterval-th frame is a keyframe coded on its own (each
+// pixel predicted from its left neighbour); the frames in between are coded as their
+// difference to the preceding keyframe if that is stored, which suits phase-contrast
+// movies with little change between frames.  Residuals are Rice-coded; frames that don't
+// get smaller are stored raw.  A few decoded keyframes are kept to decode the frames
+// depending on them.  Frames are never evicted: once the budget is used up, insert()
+// fails.  All members are thread-safe.
+class CompressedStore
+{
+   public:
+
+   struct Stats
+   {
+      std::size_t frames;   // stored
+      std::size_t bytes;    // used by the stored frames
+      std::size_t rawBytes; // the stored frames would need as Bitmaps
+      std::size_t budget;
+   };
+
+   CompressedStore(std::size_t budget, std::size_t frameCount,
+                   std::size_t keyframeInterval = 16);
+
+   CompressedStore(const CompressedStore&) = delete;
+   CompressedStore& operator=(const CompressedStore&) = delete;
+
+   // Decode a stored frame; nullptr if the frame isn't stored.
+   std::shared_ptr<const Bitmap> get(std::size_t index);
+
+   // Return false if the frame isn't stored because the budget is used up (or it is
+   // stored already).
+   bool insert(std::size_t index, const Bitmap&);
+
+   bool contains(std::size_t index) const;
+
+   // Remove a frame that became stale and, if it is a keyframe, the frames coded
+   // relative to it.  The budget they used is available again.
+   void drop(std::size_t index);
+
+   // Make room for more frames; never shrinks.
+   void resize(std::size_t frameCount);
+
+   bool isFull() const;
+
+   std::size_t getKeyframeInterval() const;
+
+   Stats getStats() const;
+
+   private:
+
+   enum Coding : Byte { raw, intra, delta };
+
+   struct Entry
+   {
+      std::size_t width, height;
+      Coding coding;
+      std::vector<Byte> data;
+      std::shared_ptr<const Entry> keyframe; // the one a delta is relative to
+   };
+
+   std::shared_ptr<const Entry> getEntry(std::size_t index) const;
+
+   // The keyframe decoded from entry, from the recently used ones if possible.  It is
+   // only kept for later if entry is still the keyframe stored at index.
+   std::shared_ptr<const Bitmap> getKeyframe(std::size_t index,
+                                             const std::shared_ptr<const Entry>& entry);
+
+   std::shared_ptr<const Bitmap> decode(const Entry&, const Bitmap* keyframe) const;
+
+   std::vector<std::shared_ptr<const Entry>> entries;
+   std::size_t keyframeInterval;
+   std::size_t bytes, rawBytes, budget, frames;
+   bool full;
+
+   // by the entries they were decoded from, most recently used first
+   std::vector<std::pair<std::shared_ptr<const Entry>, std::shared_ptr<const Bitmap>>>
+      keyframes;
+
+   mutable boost::mutex mutex;
+};
+
+inline std::size_t CompressedStore::getKeyframeInterval() const {
+   return keyframeInterval;
+}
+
+#endif //COMPRESSED_STORE_H
@@ -0,0 +1,228 @@
+#include <algorithm> // all_of, fill, max, sort
+#include <cstring>   // strlen
+#include <stdexcept> // runtime_error
+
+#define BOOST_FILESYSTEM_NO_DEPRECATED // Exclude deprecated features from headers.
+#include <boost/filesystem.hpp>
+
+#include <boost/regex.hpp> // Note: switch to <regex> from the stdlib when upgrading to a
+                           // future release of GCC.
+
+#ifdef __linux__
+  #include <dirent.h>      // DT_*
+  #include <fcntl.h>       // open()
+  #include <sys/stat.h>    // fstatat()
+  #include <sys/syscall.h> // SYS_getdents64
+  #include <unistd.h>      // close(), syscall()
+#endif
+
+#include "directory_scan.hpp"
+
+#ifdef __linux__
+
+namespace {
+   // glibc doesn't declare this; see getdents64(2).
+   struct LinuxDirent64
+   {
+      ino64_t        d_ino;
+      off64_t        d_off;
+      unsigned short d_reclen;
+      unsigned char  d_type;
+      char           d_name[1];
+   };
+}
+
+std::vector<std::string> listDirectory(const std::string& dir)
+{
+   const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+   if (fd < 0) {
+      throw std::runtime_error{"Can't open directory " + dir + "."};
+   }
+
+   std::vector<std::string> names;
+   std::vector<char> buffer(1 << 20);
+   for (;;)
+   {
+      const long size = ::syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+      if (size < 0) {
+         ::close(fd);
+         throw std::runtime_error{"Can't read directory " + dir + "."};
+      }
+      if (size == 0) break;
+
+      for (long offset = 0; offset < size;)
+      {
+         auto entry = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+         offset += entry->d_reclen;
+
+         bool regular = entry->d_type == DT_REG;
+         if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK)
+         {
+            struct stat status;
+            regular = ::fstatat(fd, entry->d_name, &status, 0) == 0 &&
+                      S_ISREG(status.st_mode);
+         }
+         if (regular) {
+            names.emplace_back(entry->d_name, std::strlen(entry->d_name));
+         }
+      }
+   }
+
+   ::close(fd);
+   return names;
+}
+
+#else
+
+std::vector<std::string> listDirectory(const std::string& dir)
+{
+   using namespace boost::filesystem;
+
+   std::vector<std::string> names;
+   try {
+      for (directory_iterator i{dir}; i != directory_iterator{}; ++i)
+      {
+         if (is_regular_file(i->status())) {
+            names.push_back(i->path().filename().string());
+         }
+      }
+   }
+   catch (const filesystem_error&) {
+      throw std::runtime_error{"Can't read directory " + dir + "."};
+   }
+   return names;
+}
+
+#endif
+
+std::vector<std::string> matchDirectory(const std::string& dir, const std::string& regEx,
+   std::size_t& files, bool& byIndex)
+{
+   files = 0;
+   byIndex = false;
+
+   const boost::filesystem::path path{dir};
+   if (!exists(path) || !is_directory(path)) {
+      return std::vector<std::string>{};
+   }
+
+   std::vector<std::string> names = listDirectory(dir);
+   files = names.size();
+
+   // Match every name, keeping what the first capture group matched if there is one.
+   const boost::regex regExObject{regEx, boost::regex::perl};
+   bool allIndexed = regExObject.mark_count() > 0;
+
+   std::vector<std::pair<unsigned long long, std::string>> matches;
+   boost::smatch match;
+   for (auto& name : names)
+   {
+      if (!boost::regex_search(name, match, regExObject)) continue;
+
+      unsigned long long index = 0;
+      if (allIndexed)
+      {
+         const auto& group = match[1];
+         allIndexed = group.matched && group.length() > 0 && group.length() < 20 &&
+            std::all_of(group.first, group.second, [](char c) {
+               return c >= '0' && c <= '9';
+            });
+         if (allIndexed) index = std::stoull(group.str());
+      }
+      matches.emplace_back(index, std::move(name));
+   }
+
+   if (allIndexed) {
+      sortByIndex(matches);
+      byIndex = true;
+   }
+   else {
+      std::sort(matches.begin(), matches.end(), [](
+            const std::pair<unsigned long long, std::string>& lhs,
+            const std::pair<unsigned long long, std::string>& rhs) {
+            return naturalLess(lhs.second, rhs.second);
+         }
+      );
+   }
+
+   names.clear();
+   names.reserve(matches.size());
+   for (auto& indexName : matches) {
+      names.push_back(std::move(indexName.second));
+   }
+   return names;
+}
+
+bool naturalLess(const std::string& lhs, const std::string& rhs)
+{
+   auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+
+   std::size_t i = 0, j = 0;
+   while (i < lhs.size() && j < rhs.size())
+   {
+      if (isDigit(lhs[i]) && isDigit(rhs[j]))
+      {
+         // Compare the runs of digits by value: skip leading zeros, then the longer run
+         // is the larger number; runs of the same length compare like strings.
+         std::size_t iEnd = i, jEnd = j;
+         while (iEnd < lhs.size() && isDigit(lhs[iEnd])) ++iEnd;
+         while (jEnd < rhs.size() && isDigit(rhs[jEnd])) ++jEnd;
+
+         std::size_t iFirst = i, jFirst = j;
+         while (iFirst + 1 < iEnd && lhs[iFirst] == '0') ++iFirst;
+         while (jFirst + 1 < jEnd && rhs[jFirst] == '0') ++jFirst;
+
+         if (iEnd - iFirst != jEnd - jFirst) {
+            return iEnd - iFirst < jEnd - jFirst;
+         }
+         int order = lhs.compare(iFirst, iEnd - iFirst, rhs, jFirst, jEnd - jFirst);
+         if (order) {
+            return order < 0;
+         }
+         // Equal values; fewer leading zeros first.
+         if (iEnd - i != jEnd - j) {
+            return iEnd - i < jEnd - j;
+         }
+         i = iEnd;
+         j = jEnd;
+      }
+      else if (lhs[i] != rhs[j]) {
+         return static_cast<unsigned char>(lhs[i]) < static_cast<unsigned char>(rhs[j]);
+      }
+      else {
+         ++i;
+         ++j;
+      }
+   }
+   return lhs.size() - i < rhs.size() - j;
+}
+
+void sortByIndex(std::vector<std::pair<unsigned long long, std::string>>& frames)
+{
+   unsigned long long max = 0;
+   for (const auto& frame : frames) {
+      max = std::max(max, frame.first);
+   }
+
+   // Sort by 16 bits at a time, starting with the least significant ones; only as many
+   // passes as the largest index needs.
+   std::vector<std::pair<unsigned long long, std::string>> sorted(frames.size());
+   std::vector<std::size_t> counts(1 << 16);
+   for (unsigned shift = 0; shift < 64 && max >> shift; shift += 16)
+   {
+      std::fill(counts.begin(), counts.end(), 0);
+      for (const auto& frame : frames) {
+         ++counts[frame.first >> shift & 0xFFFF];
+      }
+      std::size_t position = 0;
+      for (auto& count : counts) {
+         std::size_t n = count;
+         count = position;
+         position += n;
+      }
+      for (auto& frame : frames) {
+         sorted[counts[frame.first >> shift & 0xFFFF]++] = std::move(frame);
+      }
+      frames.swap(sorted);
+   }
+}
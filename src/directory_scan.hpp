@@ -0,0 +1,32 @@
+#ifndef DIRECTORY_SCAN_H
+#define DIRECTORY_SCAN_H
+
+#include <cstddef> // size_t
+#include <string>
+#include <utility> // pair
+#include <vector>
+
+// Return the names of the regular files in a directory (following symbolic links), in no
+// particular order.  On Linux, the directory is read with getdents64 in large batches and
+// files are only stat'ed if the file system doesn't report their types.  Throws
+// std::runtime_error if the directory can't be read.
+std::vector<std::string> listDirectory(const std::string& directory);
+
+// Return the names of the files in a directory that match a (Perl-derived) regular
+// expression.  If the expression has a capture group and it matches a number in every
+// name, the names are ordered by that number (and byIndex is set to true); otherwise,
+// they are sorted by naturalLess().  files is set to the number of files in the
+// directory.  Empty if the directory doesn't exist.  Throws std::runtime_error if the
+// directory can't be read and boost::regex_error if the expression is invalid.
+std::vector<std::string> matchDirectory(const std::string& directory,
+   const std::string& regEx, std::size_t& files, bool& byIndex);
+
+// Compare names with runs of digits ordered by their numeric value, so "frame_9.bmp"
+// comes before "frame_10.bmp".
+bool naturalLess(const std::string&, const std::string&);
+
+// Sort the names, which are paired with the frame indices captured from them, by index in
+// linear time (LSD radix sort).  Names with the same index keep their order.
+void sortByIndex(std::vector<std::pair<unsigned long long, std::string>>&);
+
+#endif //DIRECTORY_SCAN_H
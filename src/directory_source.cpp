@@ -0,0 +1,334 @@
+#include <algorithm> // find_if, sort
+#include <chrono>
+
+#define BOOST_FILESYSTEM_NO_DEPRECATED // Exclude deprecated features from headers.
+#include <boost/filesystem.hpp>
+
+#include <boost/regex.hpp>
+
+#ifdef __linux__
+  #include <poll.h>        // poll()
+  #include <sys/inotify.h> // inotify_*()
+  #include <unistd.h>      // close(), read()
+#endif
+
+#include "batch_reader.hpp"
+#include "bmp.hpp"
+#include "directory_scan.hpp"
+#include "directory_source.hpp"
+
+DirectorySource::DirectorySource(const std::string& dir, const std::string& regEx,
+   std::shared_ptr<DiskCache> diskCache, Listener listener, bool live) :
+   dir{dir}, names{}, diskCache{std::move(diskCache)}, scanStats{0, 0, false, 0.},
+   listener{std::move(listener)}, live{live && this->listener}, stop{false}
+{
+   using boost::filesystem::path;
+
+   // Append a directory separator if necessary, so concatenation works as expected.
+   if (this->dir.empty() || this->dir.back() != path::preferred_separator) {
+      this->dir += path::preferred_separator;
+   }
+
+   if (this->listener) {
+      scanner = boost::thread{&DirectorySource::scan, this, regEx};
+   }
+   else {
+      scan(regEx);
+   }
+}
+
+DirectorySource::~DirectorySource()
+{
+   stop = true;
+   if (scanner.joinable()) scanner.join();
+}
+
+std::size_t DirectorySource::size() const
+{
+   boost::shared_lock<boost::shared_mutex> lock{mutex};
+   return names.size();
+}
+
+std::string DirectorySource::getName(std::size_t i) const
+{
+   boost::shared_lock<boost::shared_mutex> lock{mutex};
+   return names[i];
+}
+
+std::shared_ptr<const Bitmap> DirectorySource::load(std::size_t i) const
+{
+   // Don't hold the lock while decoding; that would keep the scanner from publishing.
+   const Frame frame{&dir, getName(i)};
+
+   if (!diskCache) {
+      return frame.loadBitmap();
+   }
+   return diskCache->load(dir + frame.getFilename(),
+      [&]() { return frame.loadBitmap(); });
+}
+
+void DirectorySource::loadBatch(const std::vector<std::size_t>& indices,
+   const Sink& sink) const
+{
+   std::vector<std::size_t> toRead;
+   std::vector<std::string> fileNames;
+   std::vector<DiskCache::Key> keys;
+   for (std::size_t index : indices)
+   {
+      std::string fileName = dir + getName(index);
+      if (diskCache)
+      {
+         DiskCache::Key key;
+         if (auto bitmap = diskCache->find(fileName, key)) {
+            sink(index, bitmap);
+            continue;
+         }
+         keys.push_back(std::move(key));
+      }
+      toRead.push_back(index);
+      fileNames.push_back(std::move(fileName));
+   }
+
+   BatchReader::get().read(fileNames,
+      [&](std::size_t i, const Byte* data, std::size_t size) {
+         std::shared_ptr<const Bitmap> bitmap;
+         if (data) bitmap = Frame::decode(data, size);
+         if (!bitmap) {
+            // Leave it to load() to deal with files that can't be read, as always.
+            sink(toRead[i], load(toRead[i]));
+            return;
+         }
+         if (diskCache) diskCache->insert(keys[i], *bitmap);
+         sink(toRead[i], bitmap);
+      }
+   );
+}
+
+std::shared_ptr<const Bitmap> DirectorySource::loadRows(std::size_t index,
+   std::size_t first, std::size_t last) const
+{
+   if (auto bitmap = readBmpRows(dir + getName(index), first, last)) {
+      return bitmap;
+   }
+   return load(index);
+}
+
+std::size_t DirectorySource::getFrameHeight() const
+{
+   BmpInfo info;
+   return size() && readBmpInfo(dir + getName(0), info) ? info.height : 0;
+}
+
+std::vector<std::size_t> DirectorySource::takeRewritten()
+{
+   boost::lock_guard<boost::shared_mutex> lock{mutex};
+   std::vector<std::size_t> taken;
+   taken.swap(rewritten);
+   return taken;
+}
+
+DirectorySource::ScanStats DirectorySource::getScanStats() const
+{
+   boost::shared_lock<boost::shared_mutex> lock{mutex};
+   return scanStats;
+}
+
+void DirectorySource::scan(const std::string& regExString)
+{
+   // Watch before listing, so no file slips through in between.
+   int inotifyFd = -1;
+#ifdef __linux__
+   if (live)
+   {
+      inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+      if (inotifyFd >= 0 &&
+          ::inotify_add_watch(inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+      {
+         ::close(inotifyFd);
+         inotifyFd = -1;
+      }
+   }
+#endif
+
+   ScanStats stats{0, 0, false, 0.};
+   std::vector<std::string> matches;
+
+   try
+   {
+      const auto start = std::chrono::steady_clock::now();
+
+      matches = matchDirectory(dir, regExString, stats.files, stats.byIndex);
+      stats.matched = matches.size();
+
+      stats.seconds = std::chrono::duration<double>(
+         std::chrono::steady_clock::now() - start).count();
+   }
+   catch (...) {
+      // Publish what was found.
+      if (!listener) throw;
+   }
+
+   {
+      boost::lock_guard<boost::shared_mutex> lock{mutex};
+      scanStats = stats;
+      names.reserve(matches.size());
+   }
+
+   // Check the files in order and publish them in batches, the first two (the least a
+   // movie needs) right away.  Reading their headers is what takes time for large movies
+   // on slow disks, so only the scanning thread does that.
+   typedef std::chrono::steady_clock Clock;
+   const auto interval = std::chrono::milliseconds{100};
+   auto published = Clock::now();
+   std::size_t publishedCount = 0;
+
+   // Only what was published counts as seen while watching; a file that was rejected
+   // because it was still being written is taken in when it's closed.
+   std::unordered_multimap<std::size_t, std::size_t> indices; // by hash of the name
+
+   std::vector<std::string> batch;
+   std::size_t width = 0, height = 0;
+   for (std::size_t i = 0; i < matches.size() && !stop; ++i)
+   {
+      if (listener && !accept(matches[i], width, height)) continue;
+
+      if (inotifyFd >= 0) {
+         indices.emplace(std::hash<std::string>{}(matches[i]),
+                         publishedCount + batch.size());
+      }
+      batch.push_back(std::move(matches[i]));
+
+      if (listener && (publishedCount < 2 || Clock::now() - published >= interval))
+      {
+         {
+            boost::lock_guard<boost::shared_mutex> lock{mutex};
+            for (const auto& name : batch) names.push_back(name);
+         }
+         publishedCount += batch.size();
+         batch.clear();
+         listener(false);
+         published = Clock::now();
+      }
+   }
+
+   {
+      boost::lock_guard<boost::shared_mutex> lock{mutex};
+      for (const auto& name : batch) names.push_back(name);
+   }
+   if (listener) listener(true);
+
+   if (inotifyFd >= 0)
+   {
+      watch(inotifyFd, regExString, std::move(indices), width, height);
+#ifdef __linux__
+      ::close(inotifyFd);
+#endif
+   }
+}
+
+bool DirectorySource::accept(const std::string& name, std::size_t& width,
+   std::size_t& height) const
+{
+   BmpInfo info;
+   if (!readBmpInfo(dir + name, info)) {
+      return false;
+   }
+   if (!width) {
+      width = info.width;
+      height = info.height;
+   }
+   return info.width == width && info.height == height;
+}
+
+#ifdef __linux__
+
+void DirectorySource::watch(int inotifyFd, const std::string& regExString,
+   std::unordered_multimap<std::size_t, std::size_t> published, std::size_t width,
+   std::size_t height)
+{
+   boost::regex regEx;
+   try {
+      regEx.assign(regExString, boost::regex::perl);
+   }
+   catch (const boost::regex_error&) {
+      return;
+   }
+
+   // Take in a file; it is published right away.  If it was published already and has
+   // been written since, it is reported as rewritten instead.
+   auto take = [&](const std::string& name, bool written) {
+      if (!boost::regex_search(name, regEx)) {
+         return false;
+      }
+      // Names whose hashes collide are told apart by the names themselves; only this
+      // thread adds to names, so it reads them without the lock.
+      const std::size_t hash = std::hash<std::string>{}(name);
+      const auto candidates = published.equal_range(hash);
+      const auto found = std::find_if(candidates.first, candidates.second,
+         [this, &name](const std::pair<const std::size_t, std::size_t>& entry) {
+            return names[entry.second] == name;
+         }
+      );
+      if (found != candidates.second)
+      {
+         if (!written) return false;
+         boost::lock_guard<boost::shared_mutex> lock{mutex};
+         rewritten.push_back(found->second);
+         return true;
+      }
+      if (!accept(name, width, height)) {
+         return false;
+      }
+      boost::lock_guard<boost::shared_mutex> lock{mutex};
+      published.emplace(hash, names.size());
+      names.push_back(name);
+      return true;
+   };
+
+   alignas(inotify_event) char buffer[64 * 1024];
+   while (!stop)
+   {
+      // The timeout only bounds how long stopping takes.
+      pollfd pollFd{inotifyFd, POLLIN, 0};
+      if (::poll(&pollFd, 1, 100) <= 0) continue;
+
+      const ssize_t size = ::read(inotifyFd, buffer, sizeof(buffer));
+      if (size <= 0) continue;
+
+      bool changed = false;
+      for (ssize_t offset = 0; offset < size;)
+      {
+         auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+         offset += sizeof(inotify_event) + event->len;
+
+         if (event->mask & IN_Q_OVERFLOW)
+         {
+            // Events were lost; look for the files they were about.
+            std::vector<std::string> found;
+            try {
+               found = listDirectory(dir);
+            }
+            catch (const std::runtime_error&) {
+               continue;
+            }
+            std::sort(found.begin(), found.end(), naturalLess);
+            for (const auto& name : found) {
+               if (take(name, false)) changed = true;
+            }
+         }
+         else if (event->len && !(event->mask & IN_ISDIR) && take(event->name, true)) {
+            changed = true;
+         }
+      }
+      if (changed) listener(false);
+   }
+}
+
+#else
+
+void DirectorySource::watch(int, const std::string&,
+   std::unordered_multimap<std::size_t, std::size_t>, std::size_t, std::size_t)
+{
+}
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef DIRECTORY_SOURCE_H
+#define DIRECTORY_SOURCE_H
+
+#include <atomic>
+#include <functional> // function
+#include <memory>     // shared_ptr
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define BOOST_THREAD_USE_LIB
+#include <boost/thread.hpp> // thread, shared_mutex
+
+#include "disk_cache.hpp"
+#include "frame.hpp"
+#include "frame_source.hpp"
+#include "name_index.hpp"
+
+// The image files in a directory whose names match a (Perl-derived) regular expression.
+// If the expression has a capture group and it matches a number in every file name, the
+// frames are ordered by that number; otherwise, they are sorted by name with numbers
+// compared by value.  Decoded frames are looked up in and added to a DiskCache if one is
+// given.
+//
+// If a listener is given, the directory is scanned on a thread of its own and the frames
+// are published in order as a growing prefix: size() starts at 0 and the listener is
+// called (on the scanning thread) whenever it grew, and once more with complete set to
+// true when the scan is done.  The scan then reads the header of each file and leaves
+// out those that aren't bitmaps of the same size as the first one; without a listener,
+// e.g. for packing a movie, no file is opened before it's loaded.  All members are
+// thread-safe.
+//
+// In live mode, e.g. while a microscope is still writing frames into the directory, the
+// scanning thread then keeps watching the directory (through inotify, on Linux only).
+// Matching files that are closed after writing or moved into it are appended in the
+// order they arrive, each published right away, and the listener is called with
+// complete set to false.  A file that can't be taken in yet (e.g. because its header
+// hasn't been written) is tried again when it is closed; one that was published while
+// still being written is reported by takeRewritten() once it is closed.
+class DirectorySource : public FrameSource
+{
+   public:
+
+   typedef std::function<void(bool complete)> Listener;
+
+   // live needs a listener.
+   DirectorySource(const std::string& directory, const std::string& regEx,
+                   std::shared_ptr<DiskCache> = nullptr, Listener = nullptr,
+                   bool live = false);
+
+   // Stops scanning.
+   ~DirectorySource();
+
+   struct ScanStats
+   {
+      std::size_t files;   // regular files in the directory
+      std::size_t matched; // files whose names match the expression
+      bool        byIndex; // ordered by captured numbers rather than by name
+      double      seconds; // taken by listing, matching and sorting
+   };
+
+   DirectorySource(const DirectorySource&) = delete;
+   DirectorySource& operator=(const DirectorySource&) = delete;
+
+   virtual std::string getDir() const override;
+   virtual std::size_t size() const override;
+   virtual std::string getName(std::size_t) const override;
+   virtual std::shared_ptr<const Bitmap> load(std::size_t) const override;
+
+   // Reads the files of frames that aren't in the disk cache through the BatchReader.
+   virtual void loadBatch(const std::vector<std::size_t>& indices,
+                          const Sink&) const override;
+
+   // Reads only the rows asked for from uncompressed BMP files.
+   virtual std::shared_ptr<const Bitmap> loadRows(std::size_t index, std::size_t first,
+      std::size_t last) const override;
+   virtual bool hasRowAccess() const override;
+
+   // from the header of the first file
+   virtual std::size_t getFrameHeight() const override;
+
+   virtual std::vector<std::size_t> takeRewritten() override;
+
+   // complete once the listener was called with complete set to true
+   ScanStats getScanStats() const;
+
+   bool isLive() const;
+
+   private:
+
+   void scan(const std::string& regEx);
+
+   // true if the file is a bitmap of the given size; a width of 0 is set to the file's
+   // size.
+   bool accept(const std::string& name, std::size_t& width, std::size_t& height) const;
+
+   // Append matching files as they arrive, until stop is set.  published maps the
+   // hashes of the names published by the scan to their indices; names don't have to
+   // be kept twice that way.
+   void watch(int inotifyFd, const std::string& regEx,
+              std::unordered_multimap<std::size_t, std::size_t> published,
+              std::size_t width, std::size_t height);
+
+   std::string dir;
+   NameIndex names; // of the frames
+   std::shared_ptr<DiskCache> diskCache;
+   ScanStats scanStats;
+
+   Listener listener;
+   bool live;
+   std::vector<std::size_t> rewritten; // indices of published files closed again
+   mutable boost::shared_mutex mutex; // guards names, scanStats and rewritten
+   std::atomic<bool> stop;
+   boost::thread scanner;
+};
+
+inline std::string DirectorySource::getDir() const {
+   return dir;
+}
+
+inline bool DirectorySource::hasRowAccess() const {
+   return true;
+}
+
+inline bool DirectorySource::isLive() const {
+   return live;
+}
+
+#endif //DIRECTORY_SOURCE_H
@@ -0,0 +1,244 @@
+#include <algorithm> // sort
+#include <cstdio>    // remove, snprintf
+#include <cstdlib>   // getenv
+#include <cstring>   // memcmp, memcpy
+#include <ctime>     // time
+#include <fstream>   // ifstream, ofstream
+#include <tuple>
+#include <vector>
+
+#define BOOST_FILESYSTEM_NO_DEPRECATED // Exclude deprecated features from headers.
+#include <boost/filesystem.hpp>
+
+#include "disk_cache.hpp"
+
+namespace {
+   const char magic[8] = {'T', 'H', 'F', 'R', 'A', 'M', 'E', '\0'};
+   const char extension[] = ".frame";
+
+   // precedes the absolute path of the image file and the pixels in every entry
+   struct Header
+   {
+      char          magic[8];
+      std::uint32_t width, height;
+      std::uint64_t size;
+      std::int64_t  time;
+      std::uint32_t pathSize;
+      std::uint32_t reserved;
+   };
+
+   // 64-bit FNV-1a
+   std::uint64_t hash(const std::string& string,
+                      std::uint64_t value = 14695981039346656037u)
+   {
+      for (unsigned char c : string) {
+         value = (value ^ c) * 1099511628211u;
+      }
+      return value;
+   }
+}
+
+DiskCache::DiskCache(const std::string& dir, std::uint64_t limit) :
+   dir{dir}, limit{limit}, bytes{0}
+{
+   using namespace boost::filesystem;
+
+   if (this->dir.empty() || this->dir.back() != path::preferred_separator) {
+      this->dir += path::preferred_separator;
+   }
+
+   boost::system::error_code error;
+   create_directories(this->dir, error);
+
+   for (directory_iterator i{this->dir, error}, end; !error && i != end;
+        i.increment(error))
+   {
+      if (i->path().extension() == extension) {
+         bytes += file_size(i->path(), error);
+      }
+   }
+}
+
+std::shared_ptr<const Bitmap> DiskCache::load(const std::string& fileName,
+   const Decoder& decode)
+{
+   Key key;
+   if (auto bitmap = find(fileName, key)) {
+      return bitmap;
+   }
+
+   auto bitmap = decode();
+   if (bitmap) {
+      insert(key, *bitmap);
+   }
+   return bitmap;
+}
+
+std::shared_ptr<const Bitmap> DiskCache::find(const std::string& fileName, Key& key)
+{
+   using namespace boost::filesystem;
+
+   // Get the key before decoding; if the file changes in between, the entry is stale
+   // right away rather than never.
+   boost::system::error_code error;
+   key.path = absolute(fileName).string();
+   key.size = file_size(key.path, error);
+   if (!error) key.time = last_write_time(key.path, error);
+   if (error) {
+      key.path.clear();
+      return nullptr;
+   }
+   return read(key);
+}
+
+void DiskCache::insert(const Key& key, const Bitmap& bitmap)
+{
+   if (!key.path.empty()) {
+      write(key, bitmap);
+   }
+}
+
+std::string DiskCache::entryName(const Key& key) const
+{
+   std::uint64_t value = hash(key.path);
+   value = hash(std::to_string(key.size) + ':' + std::to_string(key.time), value);
+
+   char name[17];
+   std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(value));
+   return dir + name + extension;
+}
+
+std::shared_ptr<const Bitmap> DiskCache::read(const Key& key)
+{
+   const std::string name = entryName(key);
+   std::ifstream iStream{name, std::ios::binary};
+   if (!iStream) {
+      return nullptr;
+   }
+
+   Header header;
+   if (!iStream.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+       std::memcmp(header.magic, magic, sizeof(magic)) || header.size != key.size ||
+       header.time != key.time || header.pathSize != key.path.size())
+   {
+      return nullptr;
+   }
+
+   // Rule out hash collisions.
+   std::string path(header.pathSize, '\0');
+   if (!iStream.read(&path[0], path.size()) || path != key.path) {
+      return nullptr;
+   }
+
+   auto bitmap = std::make_shared<Bitmap>(header.width, header.height);
+   if (!iStream.read(reinterpret_cast<char*>(bitmap->pixels),
+                     std::streamsize(header.width) * header.height))
+   {
+      return nullptr;
+   }
+
+   // The modification time of an entry is when it was last used.
+   boost::system::error_code error;
+   boost::filesystem::last_write_time(name, std::time(nullptr), error);
+
+   return bitmap;
+}
+
+void DiskCache::write(const Key& key, const Bitmap& bitmap)
+{
+   Header header{};
+   std::memcpy(header.magic, magic, sizeof(magic));
+   header.width = bitmap.width;
+   header.height = bitmap.height;
+   header.size = key.size;
+   header.time = key.time;
+   header.pathSize = key.path.size();
+
+   // Write to a temporary file first, so neither other threads nor other processes read
+   // an incomplete entry.
+   const std::string name = entryName(key);
+   const std::string temporaryName = name + '.' +
+      boost::filesystem::unique_path().string();
+   {
+      std::ofstream oStream{temporaryName, std::ios::binary};
+      oStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      oStream.write(key.path.data(), key.path.size());
+      oStream.write(reinterpret_cast<const char*>(bitmap.pixels),
+                    std::streamsize(bitmap.width * bitmap.height));
+      if (!oStream) {
+         oStream.close();
+         std::remove(temporaryName.c_str());
+         return;
+      }
+   }
+
+   boost::system::error_code error;
+   boost::filesystem::rename(temporaryName, name, error);
+   if (error) {
+      std::remove(temporaryName.c_str());
+      return;
+   }
+
+   bytes += sizeof(header) + key.path.size() + bitmap.width * bitmap.height;
+   if (bytes > limit) {
+      trim();
+   }
+}
+
+void DiskCache::trim()
+{
+   using namespace boost::filesystem;
+
+   boost::unique_lock<boost::mutex> lock{trimMutex, boost::try_to_lock};
+   if (!lock) {
+      return; // Another thread is trimming already.
+   }
+
+   // Recount instead of trusting bytes; other processes may have changed the directory.
+   std::vector<std::tuple<std::time_t, std::uint64_t, path>> entries;
+   std::uint64_t total = 0;
+   boost::system::error_code error;
+   for (directory_iterator i{dir, error}, end; !error && i != end; i.increment(error))
+   {
+      if (i->path().extension() != extension) continue;
+
+      boost::system::error_code entryError;
+      std::uint64_t size = file_size(i->path(), entryError);
+      std::time_t time = last_write_time(i->path(), entryError);
+      if (!entryError) {
+         entries.emplace_back(time, size, i->path());
+         total += size;
+      }
+   }
+
+   std::sort(entries.begin(), entries.end());
+   for (const auto& entry : entries)
+   {
+      if (total <= limit / 4 * 3) break;
+      if (remove(std::get<2>(entry), error)) {
+         total -= std::get<1>(entry);
+      }
+   }
+   bytes = total;
+}
+
+std::string DiskCache::defaultDir()
+{
+   using boost::filesystem::path;
+
+   path base;
+   #ifdef _WIN32
+     if (const char* localAppData = std::getenv("LOCALAPPDATA")) {
+        base = path{localAppData} / "TrackHack";
+     }
+   #else
+     if (const char* cacheHome = std::getenv("XDG_CACHE_HOME")) {
+        base = path{cacheHome} / "track_hack";
+     }
+     else if (const char* home = std::getenv("HOME")) {
+        base = path{home} / ".cache" / "track_hack";
+     }
+   #endif
+
+   return base.empty() ? std::string{} : (base / "frames").make_preferred().string();
+}
@@ -0,0 +1,71 @@
+#ifndef DISK_CACHE_H
+#define DISK_CACHE_H
+
+#include <atomic>
+#include <cstdint>    // uint64_t
+#include <functional> // function
+#include <memory>     // shared_ptr
+#include <string>
+
+#define BOOST_THREAD_USE_LIB
+#include <boost/thread.hpp> // mutex
+
+#include "bitmap.hpp"
+
+// Keeps decoded frames in files under a directory so image files don't have to be decoded
+// again when a movie is reopened.  Entries are keyed by the image file's path, size and
+// modification time, so a changed file is decoded again.  When the entries exceed the
+// size limit, the least recently used ones are deleted.  All members are thread-safe, and
+// several processes may share a directory.
+class DiskCache
+{
+   public:
+
+   DiskCache(const std::string& directory, std::uint64_t limit);
+
+   DiskCache(const DiskCache&) = delete;
+   DiskCache& operator=(const DiskCache&) = delete;
+
+   typedef std::function<std::shared_ptr<const Bitmap>()> Decoder;
+
+   // Return the frame decoded from the image file, read from the cache if it holds an up
+   // to date entry.  Otherwise, call decode and store the result.
+   std::shared_ptr<const Bitmap> load(const std::string& fileName, const Decoder& decode);
+
+   // Identifies the contents of an image file; an empty path if it can't be determined.
+   struct Key
+   {
+      std::string   path; // absolute
+      std::uint64_t size;
+      std::int64_t  time; // of the last modification
+   };
+
+   // The two halves of load() for callers that read image files themselves: find() sets
+   // the key and returns the cached frame, or nullptr if there is no up to date entry;
+   // insert() stores the frame decoded afterwards.
+   std::shared_ptr<const Bitmap> find(const std::string& fileName, Key&);
+   void insert(const Key&, const Bitmap&);
+
+   // A directory below the user's cache directory (XDG_CACHE_HOME or ~/.cache, or
+   // LOCALAPPDATA on Windows).  Empty if none could be determined.
+   static std::string defaultDir();
+
+   private:
+
+   std::string entryName(const Key&) const;
+
+   std::shared_ptr<const Bitmap> read(const Key&);
+   void write(const Key&, const Bitmap&);
+
+   // Delete the least recently used entries until they take up no more than 3/4 of the
+   // limit.
+   void trim();
+
+   std::string dir; // ends with a separator
+   std::uint64_t limit;
+
+   std::atomic<std::uint64_t> bytes; // approximate size of all entries
+   boost::mutex trimMutex;
+};
+
+#endif //DISK_CACHE_H
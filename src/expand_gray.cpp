@@ -0,0 +1,93 @@
+#include "expand_gray.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define EXPAND_GRAY_SSSE3
+  #include <tmmintrin.h> // _mm_shuffle_epi8()
+#endif
+
+namespace {
+   void expandScalar(const Byte* gray, std::size_t count, Byte* target,
+      unsigned pixelSize)
+   {
+      if (pixelSize == 3)
+      {
+         for (std::size_t i = 0; i < count; ++i, target += 3) {
+            target[0] = target[1] = target[2] = gray[i];
+         }
+         return;
+      }
+      for (std::size_t i = 0; i < count; ++i, target += 4) {
+         target[0] = target[1] = target[2] = gray[i];
+         target[3] = 0xff;
+      }
+   }
+
+#ifdef EXPAND_GRAY_SSSE3
+
+   // 16 pixels at a time: each shuffle picks the gray values of the output bytes of a
+   // 16-byte block.
+   __attribute__((target("ssse3")))
+   void expandSsse3(const Byte* gray, std::size_t count, Byte* target,
+      unsigned pixelSize)
+   {
+      std::size_t i = 0;
+      if (pixelSize == 3)
+      {
+         const __m128i first = _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4,
+                                              5);
+         const __m128i second = _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9,
+                                              10, 10);
+         const __m128i third = _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14,
+                                             14, 14, 15, 15, 15);
+         for (; i + 16 <= count; i += 16, target += 48)
+         {
+            const __m128i pixels =
+               _mm_loadu_si128(reinterpret_cast<const __m128i*>(gray + i));
+            __m128i* out = reinterpret_cast<__m128i*>(target);
+            _mm_storeu_si128(out, _mm_shuffle_epi8(pixels, first));
+            _mm_storeu_si128(out + 1, _mm_shuffle_epi8(pixels, second));
+            _mm_storeu_si128(out + 2, _mm_shuffle_epi8(pixels, third));
+         }
+      }
+      else
+      {
+         // -1 yields 0, which the alpha mask then sets.
+         const __m128i alpha = _mm_set1_epi32(int(0xff000000));
+         for (; i + 16 <= count; i += 16, target += 64)
+         {
+            const __m128i pixels =
+               _mm_loadu_si128(reinterpret_cast<const __m128i*>(gray + i));
+            __m128i* out = reinterpret_cast<__m128i*>(target);
+            for (int k = 0; k < 4; ++k)
+            {
+               const char p = char(4 * k);
+               const __m128i mask = _mm_setr_epi8(p, p, p, -1, p + 1, p + 1, p + 1, -1,
+                  p + 2, p + 2, p + 2, -1, p + 3, p + 3, p + 3, -1);
+               _mm_storeu_si128(out + k,
+                  _mm_or_si128(_mm_shuffle_epi8(pixels, mask), alpha));
+            }
+         }
+      }
+      expandScalar(gray + i, count - i, target, pixelSize);
+   }
+
+   typedef void (*Expand)(const Byte*, std::size_t, Byte*, unsigned);
+
+   Expand chooseExpand()
+   {
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("ssse3") ? expandSsse3 : expandScalar;
+   }
+
+#endif
+}
+
+void expandGray(const Byte* gray, std::size_t count, Byte* target, unsigned pixelSize)
+{
+#ifdef EXPAND_GRAY_SSSE3
+   static const Expand expand = chooseExpand();
+   expand(gray, count, target, pixelSize);
+#else
+   expandScalar(gray, count, target, pixelSize);
+#endif
+}
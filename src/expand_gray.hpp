@@ -0,0 +1,14 @@
+#ifndef EXPAND_GRAY_H
+#define EXPAND_GRAY_H
+
+#include <cstddef> // size_t
+
+#include "bitmap.hpp" // Byte
+
+// Expand 8-bit gray pixels to pixelSize (3 or 4) bytes each, e.g. into a row of a native
+// 24 or 32-bit bitmap: every byte of a pixel is set to its gray value, except the fourth,
+// which is set to 0xff (opaque).  The channel order doesn't matter for gray.  Uses SSSE3
+// if the processor has it.
+void expandGray(const Byte* gray, std::size_t count, Byte* target, unsigned pixelSize);
+
+#endif //EXPAND_GRAY_H
@@ -1,12 +1,13 @@
 #include <wx/image.h>
+#include <wx/mstream.h> // wxMemoryInputStream
 
 #include "bitmap.hpp"
 #include "frame.hpp"
 
 Frame::Frame(Frame&& frame) : dir{frame.dir}, filename{std::move(frame.filename)} {}
 
-Frame::Frame(const std::string* dir, const boost::filesystem::path& filename) :
-   dir{dir}, filename{filename}, bitmap{} {}
+Frame::Frame(const std::string* dir, std::string filename) :
+   dir{dir}, filename{std::move(filename)} {}
 
 Frame& Frame::operator=(Frame&& frame)
 {
@@ -15,29 +16,35 @@ Frame& Frame::operator=(Frame&& frame)
    return *this;
 }
 
-std::shared_ptr<const Bitmap> Frame::getBitmap(bool load) const
-{
-   auto bitmap = this->bitmap.lock();
-   if (!bitmap && load)
+namespace {
+   std::shared_ptr<const Bitmap> toBitmap(const wxImage& image)
    {
       // Code that does not allocate and initialize memory for a temporary RGB image would
-      // be potentially faster and more elegant; the CImg or OpenCV library might be
-      // a suitable replacement for wxWidgets' image loading facilities.
-      wxImage image{*dir + getFilename(), wxBITMAP_TYPE_ANY};
-      unsigned char* imageData = image.GetData();
+      // be potentially faster and more elegant; the CImg or OpenCV library might be a
+      // suitable replacement for wxWidgets' image loading facilities.
+      const unsigned char* imageData = image.GetData();
       std::size_t pixelCount = image.GetWidth() * image.GetHeight();
 
-      bitmap = std::make_shared<Bitmap>(image.GetWidth(), image.GetHeight());
+      auto bitmap = std::make_shared<Bitmap>(image.GetWidth(), image.GetHeight());
       for (std::size_t i = 0; i < pixelCount; ++i)
       {
          bitmap->pixels[i] = imageData[3 * i];
       }
+      return bitmap;
    }
-   return bitmap; // nullptr if the bitmap wasn't loaded already and the load flag was
-                  // explicitly set to false
 }
 
-void Frame::setBitmap(std::shared_ptr<const Bitmap> bitmap) const
+std::shared_ptr<const Bitmap> Frame::loadBitmap() const
 {
-   this->bitmap = bitmap;
+   return toBitmap(wxImage{*dir + getFilename(), wxBITMAP_TYPE_ANY});
+}
+
+std::shared_ptr<const Bitmap> Frame::decode(const Byte* data, std::size_t size)
+{
+   wxMemoryInputStream iStream{data, size};
+   wxImage image{iStream, wxBITMAP_TYPE_ANY};
+   if (!image.IsOk()) {
+      return nullptr;
+   }
+   return toBitmap(image);
 }
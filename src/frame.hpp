@@ -1,11 +1,9 @@
 #ifndef FRAME_H
 #define FRAME_H
 
-#include <memory> // shared_ptr, weak_ptr
-
-#define BOOST_FILESYSTEM_VERSION 3
-#define BOOST_FILESYSTEM_NO_DEPRECATED
-#include <boost/filesystem.hpp>
+#include <cstddef> // size_t
+#include <memory>  // shared_ptr
+#include <string>
 
 #include "bitmap.hpp"
 
@@ -16,39 +14,28 @@ class Frame
    Frame() = default;
    Frame(const Frame&) = delete;
    Frame(Frame&&);
-   explicit Frame(const std::string* dir, const boost::filesystem::path&);
+   explicit Frame(const std::string* dir, std::string filename);
 
    Frame& operator=(const Frame&) = delete;
    Frame& operator=(Frame&&);
 
-   friend bool operator<(const Frame&, const Frame&);
-
    std::string getFilename() const;
 
-   // When several Trackee objects ask for the image at the same time they will point to
-   // the same object.
-   std::shared_ptr<const Bitmap> getBitmap(bool load = true) const;
+   // Decode the image file.  Frames don't keep the result, so this may be called from
+   // several threads at once; sharing and caching decoded frames is up to the Movie.
+   std::shared_ptr<const Bitmap> loadBitmap() const;
 
-   void setBitmap(std::shared_ptr<const Bitmap>) const;
+   // Decode an image file that was read into memory; nullptr if that fails.
+   static std::shared_ptr<const Bitmap> decode(const Byte* data, std::size_t size);
 
    private:
 
-   const std::string*      dir;
-   boost::filesystem::path filename;
-
-   // nullptr until getBitmap() is called; once loaded the bitmap will not be deleted
-   // until the program is terminated or runs out of memory (in that case it will also be
-   // deleted due to termination).
-   mutable std::weak_ptr<const Bitmap> bitmap; // mutable because loading of the bitmap is
-                                               // deferred
+   const std::string* dir;
+   std::string        filename;
 };
 
 inline std::string Frame::getFilename() const {
-   return filename.generic_string();
-}
-
-inline bool operator<(const Frame& lhs, const Frame& rhs) {
-   return lhs.filename < rhs.filename;
+   return filename;
 }
 
 #endif //FRAME_H
@@ -0,0 +1,188 @@
+#include <algorithm> // min
+#include <fstream>   // ifstream
+#include <limits>
+#include <string>
+
+#ifdef _WIN32
+  #define NOMINMAX
+  #include <windows.h> // GlobalMemoryStatusEx()
+#else
+  #include <unistd.h>  // sysconf()
+#endif
+
+#include "frame_cache.hpp"
+
+FrameCache::FrameCache(std::size_t budget, std::size_t frameCount) :
+   slots(frameCount), resident{}, hand{0}, bytes{0}, budget{budget}, hits{0}, misses{0},
+   evictions{0} {}
+
+std::shared_ptr<const Bitmap> FrameCache::get(std::size_t index)
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   if (index < slots.size() && slots[index].bitmap)
+   {
+      ++hits;
+      slots[index].referenced = true;
+      return slots[index].bitmap;
+   }
+   ++misses;
+   return nullptr;
+}
+
+bool FrameCache::insert(std::size_t index, std::shared_ptr<const Bitmap> bitmap)
+{
+   if (!bitmap) return false;
+
+   boost::lock_guard<boost::mutex> lock{mutex};
+   if (index >= slots.size()) return false;
+
+   Slot& slot = slots[index];
+   if (slot.bitmap) { // Another thread was faster.
+      slot.referenced = true;
+      return true;
+   }
+
+   const std::size_t size = sizeOf(*bitmap);
+   if (bytes + size > budget && !evict(size)) {
+      return false;
+   }
+
+   slot.bitmap = std::move(bitmap);
+   slot.position = resident.size();
+   slot.referenced = true;
+   resident.push_back(index);
+   bytes += size;
+
+   return true;
+}
+
+bool FrameCache::contains(std::size_t index) const
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   return index < slots.size() && slots[index].bitmap;
+}
+
+bool FrameCache::isFull(std::size_t frameBytes) const
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   return bytes + frameBytes > budget;
+}
+
+void FrameCache::pin(std::size_t index)
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   if (index < slots.size()) ++slots[index].pins;
+}
+
+void FrameCache::unpin(std::size_t index)
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   if (index < slots.size() && slots[index].pins) --slots[index].pins;
+}
+
+void FrameCache::resize(std::size_t frameCount)
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   for (std::size_t i = frameCount; i < slots.size(); ++i)
+   {
+      if (slots[i].bitmap) erase(i);
+   }
+   slots.resize(frameCount);
+}
+
+void FrameCache::drop(std::size_t index)
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   if (index < slots.size() && slots[index].bitmap) erase(index);
+}
+
+FrameCache::Stats FrameCache::getStats() const
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   return Stats{hits, misses, evictions, bytes, budget};
+}
+
+std::size_t FrameCache::defaultBudget()
+{
+   std::size_t memory = std::numeric_limits<std::size_t>::max();
+
+   #ifdef _WIN32
+     MEMORYSTATUSEX status;
+     status.dwLength = sizeof(status);
+     if (::GlobalMemoryStatusEx(&status)) {
+        memory = status.ullTotalPhys;
+     }
+   #else
+     long pages = ::sysconf(_SC_PHYS_PAGES), pageSize = ::sysconf(_SC_PAGE_SIZE);
+     if (pages > 0 && pageSize > 0) {
+        memory = std::size_t(pages) * std::size_t(pageSize);
+     }
+
+     // cgroup v2 first, then v1.  The v2 file contains "max" if there is no limit; v1
+     // reports a huge number instead.
+     for (const char* fileName : {"/sys/fs/cgroup/memory.max",
+                                  "/sys/fs/cgroup/memory/memory.limit_in_bytes"})
+     {
+        std::ifstream iStream{fileName};
+        unsigned long long limit;
+        if (iStream >> limit) {
+           memory = std::min<unsigned long long>(memory, limit);
+           break;
+        }
+     }
+   #endif
+
+   if (memory == std::numeric_limits<std::size_t>::max()) {
+      memory = std::size_t{1} << 30; // Guess.
+   }
+
+   return memory / 4;
+}
+
+// Pixels owned by something else (e.g. mapped from a file) aren't counted.
+std::size_t FrameCache::sizeOf(const Bitmap& bitmap)
+{
+   return sizeof(Bitmap) + (bitmap.owner ? 0 : bitmap.width * bitmap.height);
+}
+
+bool FrameCache::evict(std::size_t bytesNeeded)
+{
+   if (bytesNeeded > budget) return false;
+
+   // Two full sweeps: the first one may only clear reference bits.
+   for (std::size_t steps = 2 * resident.size(); steps && !resident.empty() &&
+        bytes + bytesNeeded > budget; --steps)
+   {
+      if (hand >= resident.size()) hand = 0;
+
+      const std::size_t index = resident[hand];
+      Slot& slot = slots[index];
+
+      if (slot.pins || slot.bitmap.use_count() > 1) { // pinned or in use
+         ++hand;
+      }
+      else if (slot.referenced) {
+         slot.referenced = false;
+         ++hand;
+      }
+      else {
+         erase(index); // moves the last resident frame to the hand's position
+         ++evictions;
+      }
+   }
+
+   return bytes + bytesNeeded <= budget;
+}
+
+void FrameCache::erase(std::size_t index)
+{
+   Slot& slot = slots[index];
+   bytes -= sizeOf(*slot.bitmap);
+   slot.bitmap.reset();
+
+   // swap and pop
+   const std::size_t position = slot.position;
+   resident[position] = resident.back();
+   slots[resident[position]].position = position;
+   resident.pop_back();
+}
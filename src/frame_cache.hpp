@@ -0,0 +1,86 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include <cstddef> // size_t
+#include <memory>  // shared_ptr
+#include <vector>
+
+#define BOOST_THREAD_USE_LIB
+#include <boost/thread.hpp> // mutex
+
+#include "bitmap.hpp"
+
+// Holds decoded frames until a memory budget is exhausted.  Frames are evicted using the
+// CLOCK approximation of LRU; frames that are pinned or still referenced from outside the
+// cache (e.g. by the tracker) are never evicted.  All members are thread-safe.
+class FrameCache
+{
+   public:
+
+   struct Stats
+   {
+      std::size_t hits, misses, evictions;
+      std::size_t bytes, budget; // bytes currently held and the maximum
+   };
+
+   explicit FrameCache(std::size_t budget = defaultBudget(), std::size_t frameCount = 0);
+
+   FrameCache(const FrameCache&) = delete;
+   FrameCache& operator=(const FrameCache&) = delete;
+
+   // Return nullptr and count a miss if the frame isn't cached.
+   std::shared_ptr<const Bitmap> get(std::size_t index);
+
+   // Return false if the frame could not be cached without exceeding the budget.
+   bool insert(std::size_t index, std::shared_ptr<const Bitmap>);
+
+   bool contains(std::size_t index) const; // counts neither a hit nor a miss
+
+   // true if one more frame of the given size would not fit without evicting another one
+   bool isFull(std::size_t frameBytes) const;
+
+   // Pinned frames are not evicted.  Pins are counted and may precede insertion.
+   void pin(std::size_t index);
+   void unpin(std::size_t index);
+
+   void resize(std::size_t frameCount);
+
+   // Remove a frame that became stale, e.g. because its file was rewritten; its pins
+   // stay.
+   void drop(std::size_t index);
+
+   Stats getStats() const;
+
+   // A quarter of the physical memory or of the control group's memory limit, whichever
+   // is lower.
+   static std::size_t defaultBudget();
+
+   private:
+
+   struct Slot
+   {
+      std::shared_ptr<const Bitmap> bitmap;
+      std::size_t position = 0; // index into resident; only meaningful if bitmap is set
+      unsigned    pins = 0;
+      bool        referenced = false;
+   };
+
+   static std::size_t sizeOf(const Bitmap&);
+
+   // Advance the clock hand and evict frames until bytesNeeded more bytes fit; the mutex
+   // has to be held.
+   bool evict(std::size_t bytesNeeded);
+
+   void erase(std::size_t index);
+
+   std::vector<Slot> slots;           // one per frame of the movie
+   std::vector<std::size_t> resident; // indices of cached frames; swept by the hand
+   std::size_t hand;
+
+   std::size_t bytes, budget;
+   std::size_t hits, misses, evictions;
+
+   mutable boost::mutex mutex;
+};
+
+#endif //FRAME_CACHE_H
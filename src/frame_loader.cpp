@@ -0,0 +1,301 @@
+#include <algorithm> // min
+
+#include "frame_loader.hpp"
+
+constexpr std::size_t FrameLoader::maxBatch;
+
+FrameLoader::FrameLoader(FrameCache& cache, Decoder decoder, unsigned threadCount,
+   BatchDecoder batchDecoder, RowDecoder rowDecoder) :
+   cache(cache), decoder{std::move(decoder)}, batchDecoder{std::move(batchDecoder)},
+   rowDecoder{std::move(rowDecoder)}, rowRequests{}, urgentRequests{}, prefetches{},
+   requests{}, inFlight{}, rows{}, terminate{false}
+{
+   if (!threadCount) {
+      threadCount = boost::thread::hardware_concurrency();
+      if (!threadCount) threadCount = 1;
+   }
+
+   for (unsigned i = 0; i < threadCount; ++i) {
+      workers.emplace_back(&FrameLoader::work, this);
+   }
+}
+
+FrameLoader::~FrameLoader()
+{
+   {
+      boost::lock_guard<boost::mutex> lock{mutex};
+      terminate = true;
+      rowRequests.clear();
+      urgentRequests.clear();
+      prefetches.clear();
+      requests.clear();
+   }
+   requested.notify_all();
+
+   for (auto& worker : workers) {
+      worker.join();
+   }
+}
+
+std::shared_ptr<const Bitmap> FrameLoader::load(std::size_t index)
+{
+   std::shared_ptr<Pending> pending;
+   {
+      boost::unique_lock<boost::mutex> lock{mutex};
+
+      auto it = inFlight.find(index);
+      if (it != inFlight.end())
+      {
+         pending = it->second;
+         published.wait(lock, [&pending]{ return pending->done; });
+         return pending->bitmap;
+      }
+
+      if (auto bitmap = cache.get(index)) {
+         return bitmap;
+      }
+
+      pending = std::make_shared<Pending>();
+      inFlight.emplace(index, pending);
+   }
+   return decode(index, std::move(pending));
+}
+
+void FrameLoader::request(std::size_t index, Priority priority)
+{
+   {
+      boost::lock_guard<boost::mutex> lock{mutex};
+      if (terminate || inFlight.count(index) || cache.contains(index)) return;
+      (priority == Priority::high ? urgentRequests : requests).push_back(index);
+   }
+   requested.notify_one();
+}
+
+void FrameLoader::prefetch(const std::vector<std::size_t>& indices)
+{
+   {
+      boost::lock_guard<boost::mutex> lock{mutex};
+      if (terminate) return;
+
+      prefetches.clear();
+      for (std::size_t index : indices)
+      {
+         if (!inFlight.count(index) && !cache.contains(index)) {
+            prefetches.push_back(index);
+         }
+      }
+   }
+   requested.notify_all();
+}
+
+void FrameLoader::requestRows(std::size_t index, std::size_t first, std::size_t last)
+{
+   if (!rowDecoder) {
+      request(index, Priority::high);
+      return;
+   }
+
+   {
+      boost::lock_guard<boost::mutex> lock{mutex};
+      if (terminate || cache.contains(index)) return;
+
+      auto entry = std::make_shared<Rows>();
+      entry->first = first;
+      entry->last = last;
+      rows[index] = std::move(entry);
+      rowRequests.push_back(index);
+   }
+   requested.notify_one();
+}
+
+std::shared_ptr<const Bitmap> FrameLoader::loadRows(std::size_t index, std::size_t first,
+   std::size_t last)
+{
+   if (!rowDecoder) {
+      return load(index);
+   }
+
+   {
+      boost::unique_lock<boost::mutex> lock{mutex};
+      if (auto bitmap = cache.get(index)) {
+         return bitmap;
+      }
+
+      auto it = rows.find(index);
+      if (it != rows.end())
+      {
+         // Rows no worker has started on yet are decoded here; a worker skips them.
+         std::shared_ptr<Rows> entry = std::move(it->second);
+         rows.erase(it);
+         if (entry->started && entry->first <= first && last <= entry->last)
+         {
+            published.wait(lock, [&entry]{ return entry->done; });
+            if (entry->bitmap) return entry->bitmap;
+         }
+      }
+   }
+   return rowDecoder(index, first, last);
+}
+
+void FrameLoader::cancel()
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   rowRequests.clear();
+   rows.clear();
+   urgentRequests.clear();
+   prefetches.clear();
+   requests.clear();
+}
+
+void FrameLoader::cancel(Priority priority)
+{
+   boost::lock_guard<boost::mutex> lock{mutex};
+   if (priority == Priority::high)
+   {
+      rowRequests.clear();
+      rows.clear();
+      urgentRequests.clear();
+   }
+   else {
+      requests.clear();
+   }
+}
+
+void FrameLoader::work()
+{
+   for (;;)
+   {
+      std::vector<std::size_t> indices;
+      std::vector<std::shared_ptr<Pending>> pendings;
+      std::shared_ptr<Rows> entry;
+      {
+         boost::unique_lock<boost::mutex> lock{mutex};
+         requested.wait(lock, [this]{
+               return terminate || !rowRequests.empty() || !urgentRequests.empty() ||
+                      !prefetches.empty() || !requests.empty();
+            }
+         );
+         if (terminate) return;
+
+         if (!rowRequests.empty())
+         {
+            const std::size_t index = rowRequests.front();
+            rowRequests.pop_front();
+
+            // The rows may have been taken or replaced since they were requested.
+            auto it = rows.find(index);
+            if (it == rows.end() || it->second->started) continue;
+            entry = it->second;
+            entry->started = true;
+            indices.push_back(index);
+         }
+         else
+         {
+            auto& queue = !urgentRequests.empty() ? urgentRequests :
+                          !prefetches.empty()     ? prefetches : requests;
+
+            // Leave the rest of the queue to the other workers.
+            const std::size_t batchSize = !batchDecoder ? 1 :
+               std::min(maxBatch, (queue.size() + workers.size() - 1) / workers.size());
+
+            while (!queue.empty() && indices.size() < batchSize)
+            {
+               const std::size_t index = queue.front();
+               queue.pop_front();
+
+               // The frame may have been loaded since it was requested.
+               if (inFlight.count(index) || cache.contains(index)) continue;
+
+               pendings.push_back(std::make_shared<Pending>());
+               inFlight.emplace(index, pendings.back());
+               indices.push_back(index);
+            }
+         }
+      }
+
+      if (entry) {
+         decode(indices.front(), *entry);
+      }
+      else if (indices.size() == 1) {
+         decode(indices.front(), std::move(pendings.front()));
+      }
+      else if (!indices.empty()) {
+         decode(indices, std::move(pendings));
+      }
+   }
+}
+
+std::shared_ptr<const Bitmap> FrameLoader::decode(std::size_t index,
+   std::shared_ptr<Pending> pending)
+{
+   std::shared_ptr<const Bitmap> bitmap;
+   try {
+      bitmap = decoder(index);
+   }
+   catch (...) {
+      // Don't leave waiting threads hanging; they get nullptr.
+   }
+
+   publish(index, *pending, bitmap);
+   return bitmap;
+}
+
+void FrameLoader::decode(const std::vector<std::size_t>& indices,
+   std::vector<std::shared_ptr<Pending>> pendings)
+{
+   std::unordered_map<std::size_t, std::shared_ptr<Pending>> batch;
+   for (std::size_t i = 0; i < indices.size(); ++i) {
+      batch.emplace(indices[i], std::move(pendings[i]));
+   }
+
+   try
+   {
+      batchDecoder(indices, [this, &batch](std::size_t index,
+                                           std::shared_ptr<const Bitmap> bitmap) {
+            auto it = batch.find(index);
+            if (it == batch.end()) return;
+            publish(index, *it->second, std::move(bitmap));
+            batch.erase(it);
+         }
+      );
+   }
+   catch (...) {
+   }
+
+   // Don't leave threads waiting for frames the decoder skipped or failed on hanging;
+   // they get nullptr.
+   for (auto& indexPending : batch) {
+      publish(indexPending.first, *indexPending.second, nullptr);
+   }
+}
+
+void FrameLoader::decode(std::size_t index, Rows& entry)
+{
+   std::shared_ptr<const Bitmap> bitmap;
+   try {
+      bitmap = rowDecoder(index, entry.first, entry.last);
+   }
+   catch (...) {
+      // The thread taking the rows decodes them itself.
+   }
+
+   {
+      boost::lock_guard<boost::mutex> lock{mutex};
+      entry.bitmap = std::move(bitmap);
+      entry.done = true;
+   }
+   published.notify_all();
+}
+
+void FrameLoader::publish(std::size_t index, Pending& pending,
+   std::shared_ptr<const Bitmap> bitmap)
+{
+   cache.insert(index, bitmap);
+   {
+      boost::lock_guard<boost::mutex> lock{mutex};
+      pending.bitmap = std::move(bitmap);
+      pending.done = true;
+      inFlight.erase(index);
+   }
+   published.notify_all();
+}
@@ -0,0 +1,134 @@
+#ifndef FRAME_LOADER_H
+#define FRAME_LOADER_H
+
+#include <cstddef>    // size_t
+#include <deque>
+#include <functional> // function
+#include <memory>     // shared_ptr
+#include <unordered_map>
+#include <vector>
+
+#define BOOST_THREAD_USE_LIB
+#include <boost/thread.hpp> // thread, mutex, condition_variable
+
+#include "bitmap.hpp"
+#include "frame_cache.hpp"
+
+// Decodes frames on a pool of worker threads and publishes them to a FrameCache.  Every
+// frame is decoded at most once at a time: concurrent requests for a frame that is still
+// being decoded wait for that decode instead of starting another one.
+class FrameLoader
+{
+   public:
+
+   typedef std::function<std::shared_ptr<const Bitmap>(std::size_t)> Decoder;
+
+   // Decodes several frames, passing each one to the sink as soon as it is decoded.
+   typedef std::function<void(std::size_t, std::shared_ptr<const Bitmap>)> Sink;
+   typedef std::function<void(const std::vector<std::size_t>&, const Sink&)> BatchDecoder;
+
+   // Decodes at least rows first to last (exclusive) of a frame, e.g. into a band (see
+   // Bitmap).
+   typedef std::function<std::shared_ptr<const Bitmap>(std::size_t, std::size_t first,
+                                                       std::size_t last)> RowDecoder;
+
+   // High priority requests are served before prefetches, low priority ones after.
+   enum class Priority { low, high };
+
+   // A threadCount of 0 uses one worker per hardware thread.  If a batch decoder is
+   // given, workers take several queued requests at once (their share of the queue, up to
+   // maxBatch) and decode them with it, so their reads can overlap.  Without a row
+   // decoder, requests for rows are served with whole frames.
+   FrameLoader(FrameCache&, Decoder, unsigned threadCount = 0,
+               BatchDecoder = nullptr, RowDecoder = nullptr);
+
+   FrameLoader(const FrameLoader&) = delete;
+   FrameLoader& operator=(const FrameLoader&) = delete;
+
+   // Drops queued requests and joins the workers after their current decode.
+   ~FrameLoader();
+
+   // Return the frame, decoding it on the calling thread unless it is cached or already
+   // being decoded by another thread (then wait for that).
+   std::shared_ptr<const Bitmap> load(std::size_t index);
+
+   // Queue the frame for decoding by a worker unless it is cached or being decoded.
+   void request(std::size_t index, Priority = Priority::low);
+
+   // Replace the queue of prefetch requests.  Frames are decoded in the given order.
+   void prefetch(const std::vector<std::size_t>& indices);
+
+   // Queue rows first to last (exclusive) of the frame for decoding by a worker, before
+   // any frame, unless the frame is cached.  The rows aren't cached; they are kept for
+   // loadRows() instead, replacing rows requested for the frame before.
+   void requestRows(std::size_t index, std::size_t first, std::size_t last);
+
+   // Return the frame if it is cached.  Otherwise, return the rows requested for it if
+   // they include rows first to last, waiting for a worker that is decoding them; or
+   // decode the rows on the calling thread.  Requested rows are returned once.
+   std::shared_ptr<const Bitmap> loadRows(std::size_t index, std::size_t first,
+                                          std::size_t last);
+
+   // Drop all queued requests; decodes that already started are completed.
+   void cancel();
+
+   // Drop only the queued requests of the given priority; rows count as high priority.
+   void cancel(Priority);
+
+   private:
+
+   struct Pending
+   {
+      bool done = false;
+      std::shared_ptr<const Bitmap> bitmap;
+   };
+
+   struct Rows
+   {
+      std::size_t first, last;
+      bool started = false;
+      bool done = false;
+      std::shared_ptr<const Bitmap> bitmap;
+   };
+
+   static constexpr std::size_t maxBatch = 32;
+
+   void work();
+
+   // Decode the frame of a pending entry and publish the result; the mutex must not be
+   // held.
+   std::shared_ptr<const Bitmap> decode(std::size_t index, std::shared_ptr<Pending>);
+
+   // Decode the frames of several pending entries with the batch decoder; the mutex must
+   // not be held.
+   void decode(const std::vector<std::size_t>& indices,
+               std::vector<std::shared_ptr<Pending>>);
+
+   // Cache the frame and complete its pending entry; the mutex must not be held.
+   void publish(std::size_t index, Pending&, std::shared_ptr<const Bitmap>);
+
+   // Decode requested rows and complete their entry; the mutex must not be held.
+   void decode(std::size_t index, Rows&);
+
+   FrameCache& cache;
+   Decoder decoder;
+   BatchDecoder batchDecoder;
+   RowDecoder rowDecoder;
+
+   // served in this order
+   std::deque<std::size_t> rowRequests;
+   std::deque<std::size_t> urgentRequests;
+   std::deque<std::size_t> prefetches;
+   std::deque<std::size_t> requests;
+   std::unordered_map<std::size_t, std::shared_ptr<Pending>> inFlight;
+   std::unordered_map<std::size_t, std::shared_ptr<Rows>> rows; // not taken yet
+
+   bool terminate;
+   boost::mutex mutex;
+   boost::condition_variable requested; // signalled when requests get added
+   boost::condition_variable published; // signalled when a decode completes
+
+   std::vector<boost::thread> workers;
+};
+
+#endif //FRAME_LOADER_H
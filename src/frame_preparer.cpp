@@ -0,0 +1,45 @@
+#include "expand_gray.hpp"
+#include "frame_preparer.hpp"
+#include "scale_gray.hpp"
+
+FramePreparer::FramePreparer(Handler handler) :
+   worker{
+      [](const Request& request, std::shared_ptr<const Bitmap>& bitmap) {
+         // If there is no frame, the user interface keeps showing what it showed.
+         bitmap = request.movie->getBitmap(request.index);
+         return bool(bitmap);
+      },
+      [handler](const Request& request, std::shared_ptr<const Bitmap>& bitmap) {
+         wxImage image, scaled;
+         if (request.whole)
+         {
+            image = wxImage{int(bitmap->width), int(bitmap->height), false};
+            expandGray(bitmap->pixels, bitmap->width * bitmap->height, image.GetData(),
+               3);
+         }
+         const int width = request.scaledSize.GetWidth(),
+                   height = request.scaledSize.GetHeight();
+         if (width > 0 && height > 0)
+         {
+            std::shared_ptr<const Bitmap> small = scaleGray(*bitmap, width, height);
+            scaled = wxImage{width, height, false};
+            expandGray(small->pixels, small->width * small->height, scaled.GetData(),
+               3);
+         }
+         bitmap.reset();
+         handler(request.index, request.tag, image, scaled);
+      }
+   }
+{
+}
+
+void FramePreparer::request(const Movie& movie, std::size_t index, unsigned long tag,
+   const wxSize& scaledSize, bool whole)
+{
+   worker.request(Request{&movie, index, tag, scaledSize, whole});
+}
+
+void FramePreparer::cancel()
+{
+   worker.cancel();
+}
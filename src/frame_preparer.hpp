@@ -0,0 +1,66 @@
+#ifndef FRAME_PREPARER_H
+#define FRAME_PREPARER_H
+
+#include <cstddef>    // size_t
+#include <functional> // function
+#include <memory>     // shared_ptr
+
+#include <wx/gdicmn.h> // wxSize
+#include <wx/image.h>  // wxImage
+
+#include "latest_request_worker.hpp"
+#include "movie.hpp"
+
+// Decodes frames of a Movie and converts them to (RGB) wxImages on a thread of its own,
+// whole and scaled to the size they're shown at, so the user interface needn't wait for
+// any of it.  Only the latest request counts: a request that wasn't started yet when the
+// next one comes is dropped, and so is a frame that was decoded after it was superseded.
+// wxBitmaps can't be created off the main thread, so that is left to the handler's
+// owner.
+class FramePreparer
+{
+   public:
+
+   // Called on the preparing thread with the frame's index, the tag of the request, the
+   // image of the whole frame (null if it wasn't asked for) and the scaled one (null if
+   // no size was given); the preparer doesn't refer to them afterwards.
+   typedef std::function<void(std::size_t index, unsigned long tag, wxImage& image,
+                              wxImage& scaled)> Handler;
+
+   // The thread stops when the preparer goes.
+   explicit FramePreparer(Handler);
+
+   // Prepare a frame instead of the one requested before, scaled to scaledSize (see
+   // scaleGray()) unless that is empty, and whole unless only the scaled image is wanted,
+   // e.g. for a frame shown already; does nothing if the same is being prepared or
+   // waiting already.  The movie has to stay until the frame is handled or cancel()
+   // returns.
+   void request(const Movie&, std::size_t index, unsigned long tag,
+                const wxSize& scaledSize, bool whole = true);
+
+   // Drop the waiting request and wait until no frame is being prepared, e.g. before the
+   // movie goes.
+   void cancel();
+
+   private:
+
+   struct Request
+   {
+      const Movie* movie;
+      std::size_t index;
+      unsigned long tag;
+      wxSize scaledSize;
+      bool whole;
+
+      bool operator==(const Request&) const;
+   };
+
+   LatestRequestWorker<Request, std::shared_ptr<const Bitmap>> worker;
+};
+
+inline bool FramePreparer::Request::operator==(const Request& other) const {
+   return movie == other.movie && index == other.index && tag == other.tag &&
+      scaledSize == other.scaledSize && whole == other.whole;
+}
+
+#endif //FRAME_PREPARER_H
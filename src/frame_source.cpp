@@ -0,0 +1,30 @@
+#include <algorithm> // transform
+#include <cctype>    // tolower
+#include <stdexcept> // runtime_error
+
+#define BOOST_FILESYSTEM_NO_DEPRECATED // Exclude deprecated features from headers.
+#include <boost/filesystem.hpp>
+
+#include "frame_source.hpp"
+#include "packed_movie.hpp"
+#include "stream_source.hpp"
+#include "tiff_source.hpp"
+
+std::unique_ptr<FrameSource> openFrameSource(const std::string& fileName)
+{
+   std::string extension = boost::filesystem::path{fileName}.extension().string();
+   std::transform(extension.begin(), extension.end(), extension.begin(),
+      [](unsigned char c) { return std::tolower(c); });
+
+   if (extension == ".thm") {
+      return std::unique_ptr<FrameSource>{new PackedSource{fileName}};
+   }
+   if (extension == ".tif" || extension == ".tiff") {
+      return std::unique_ptr<FrameSource>{new TiffSource{fileName}};
+   }
+   if (extension == ".y4m") {
+      return std::unique_ptr<FrameSource>{new StreamSource{fileName}};
+   }
+
+   throw std::runtime_error{"Unsupported movie file: " + fileName};
+}
@@ -0,0 +1,85 @@
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <cstddef>    // size_t
+#include <functional> // function
+#include <memory>     // shared_ptr, unique_ptr
+#include <string>
+#include <vector>
+
+#include "bitmap.hpp"
+
+// Where the frames of a Movie come from.  Implementations have to allow load() to be
+// called from several threads at once.
+class FrameSource
+{
+   public:
+
+   virtual ~FrameSource() = default;
+
+   // The directory output files (e.g. tracks) are written to; ends with a separator.
+   virtual std::string getDir() const = 0;
+
+   virtual std::size_t size() const = 0;
+
+   // A name identifying the frame, e.g. the file name it was read from.
+   virtual std::string getName(std::size_t) const = 0;
+
+   // Decode a frame.  All frames of a source have the same size.
+   virtual std::shared_ptr<const Bitmap> load(std::size_t) const = 0;
+
+   typedef std::function<void(std::size_t index, std::shared_ptr<const Bitmap>)> Sink;
+
+   // Decode several frames and pass each to sink (on the calling thread) as soon as it is
+   // decoded, in any order; nullptr for frames that can't be decoded.  Sources that can
+   // overlap reading the frames do so; by default, they are loaded one after another.
+   virtual void loadBatch(const std::vector<std::size_t>& indices, const Sink&) const;
+
+   // Decode at least rows first to last (exclusive) of a frame, e.g. into a band (see
+   // Bitmap).  Sources that can't read rows on their own decode the whole frame.
+   virtual std::shared_ptr<const Bitmap> loadRows(std::size_t index, std::size_t first,
+      std::size_t last) const;
+
+   // true if loadRows() is cheaper than load() for small bands of rows
+   virtual bool hasRowAccess() const;
+
+   // The height of the frames if it can be told without decoding one; 0 otherwise.
+   virtual std::size_t getFrameHeight() const;
+
+   // The indices of frames that were written again after they were published (e.g.
+   // files that were still being written), since the last call; what was decoded from
+   // them before is stale.  Thread-safe.
+   virtual std::vector<std::size_t> takeRewritten();
+};
+
+inline void FrameSource::loadBatch(const std::vector<std::size_t>& indices,
+   const Sink& sink) const
+{
+   for (std::size_t index : indices) {
+      sink(index, load(index));
+   }
+}
+
+inline std::shared_ptr<const Bitmap> FrameSource::loadRows(std::size_t index,
+   std::size_t, std::size_t) const
+{
+   return load(index);
+}
+
+inline bool FrameSource::hasRowAccess() const {
+   return false;
+}
+
+inline std::size_t FrameSource::getFrameHeight() const {
+   return 0;
+}
+
+inline std::vector<std::size_t> FrameSource::takeRewritten() {
+   return {};
+}
+
+// Open a file holding a whole movie; the type of source is chosen by the file name's
+// extension.  Throws std::runtime_error if the file isn't supported or can't be read.
+std::unique_ptr<FrameSource> openFrameSource(const std::string& fileName);
+
+#endif //FRAME_SOURCE_H
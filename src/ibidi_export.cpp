@@ -48,13 +48,13 @@ void ibidiExport(const std::string& fileName,
    {
       const Trackee& trackee = trackees.at(std::to_string(index));
       // trackee.getTrack() returns a weak_ptr. weak_ptr::lock() returns a shared_ptr.
-      const Track track = *trackee.getTrack().lock();
+      std::shared_ptr<const Track> track = trackee.getTrack().lock();
 
       unsigned j = 0;
-      for (; j < track.size(); ++j)
+      for (; j < track->size(); ++j)
       {
-         oStream << i + j << '\t' << index << '\t' << j + 1 << '\t' << track[j].x << '\t'
-                 << track[j].y << '\n';
+         oStream << i + j << '\t' << index << '\t' << j + 1 << '\t' << (*track)[j].x
+                 << '\t' << (*track)[j].y << '\n';
       }
       i += j;
    }
@@ -0,0 +1,136 @@
+#ifndef LATEST_REQUEST_WORKER_H
+#define LATEST_REQUEST_WORKER_H
+
+#include <functional> // function
+#include <utility>    // move
+
+#define BOOST_THREAD_USE_LIB
+#include <boost/thread.hpp> // thread, mutex, condition_variable
+
+// Serves requests on a thread of its own, only the latest of them: a request that wasn't
+// started yet when the next one comes is dropped, and so is the result of one that was
+// superseded while it was being served.  Requests are compared with ==.
+template <class Request, class Result>
+class LatestRequestWorker
+{
+   public:
+
+   // Both are called on the worker's thread.  Work returns false if there's no result;
+   // exceptions count as no result.  The handler gets the results of the requests that
+   // are still the latest once they're done.
+   typedef std::function<bool(const Request&, Result&)> Work;
+   typedef std::function<void(const Request&, Result&)> Handler;
+
+   LatestRequestWorker(Work, Handler);
+
+   // Stops the thread.
+   ~LatestRequestWorker();
+
+   LatestRequestWorker(const LatestRequestWorker&) = delete;
+   LatestRequestWorker& operator=(const LatestRequestWorker&) = delete;
+
+   // Serve a request instead of the one made before; does nothing if the same one is
+   // being served or waiting already.
+   void request(const Request&);
+
+   // Drop the waiting request and wait until none is being served.
+   void cancel();
+
+   private:
+
+   void run();
+
+   Work work;
+   Handler handler;
+
+   boost::mutex mutex; // guards the members below
+   boost::condition_variable condition;
+   Request waiting, current;
+   bool hasWaiting, busy, stopping;
+
+   boost::thread thread;
+};
+
+template <class Request, class Result>
+LatestRequestWorker<Request, Result>::LatestRequestWorker(Work work, Handler handler) :
+   work{std::move(work)}, handler{std::move(handler)}, waiting{}, current{},
+   hasWaiting{false}, busy{false}, stopping{false}
+{
+   thread = boost::thread{&LatestRequestWorker::run, this};
+}
+
+template <class Request, class Result>
+LatestRequestWorker<Request, Result>::~LatestRequestWorker()
+{
+   {
+      boost::lock_guard<boost::mutex> lock{mutex};
+      stopping = true;
+      hasWaiting = false;
+   }
+   condition.notify_all();
+   thread.join();
+}
+
+template <class Request, class Result>
+void LatestRequestWorker<Request, Result>::request(const Request& request)
+{
+   {
+      boost::lock_guard<boost::mutex> lock{mutex};
+      if ((busy && current == request) || (hasWaiting && waiting == request)) {
+         return;
+      }
+      waiting = request;
+      hasWaiting = true;
+   }
+   condition.notify_all();
+}
+
+template <class Request, class Result>
+void LatestRequestWorker<Request, Result>::cancel()
+{
+   boost::unique_lock<boost::mutex> lock{mutex};
+   hasWaiting = false;
+   while (busy) {
+      condition.wait(lock);
+   }
+}
+
+template <class Request, class Result>
+void LatestRequestWorker<Request, Result>::run()
+{
+   boost::unique_lock<boost::mutex> lock{mutex};
+   for (;;)
+   {
+      while (!hasWaiting && !stopping) {
+         condition.wait(lock);
+      }
+      if (stopping) {
+         return;
+      }
+      current = waiting;
+      hasWaiting = false;
+      busy = true;
+      lock.unlock();
+
+      Result result{};
+      bool done = false;
+      try {
+         done = work(current, result);
+      }
+      catch (...) {
+         // no result
+      }
+
+      lock.lock();
+      if (done && !hasWaiting && !stopping)
+      {
+         lock.unlock();
+         handler(current, result);
+         lock.lock();
+      }
+      busy = false;
+      condition.notify_all();
+   }
+}
+
+#endif //LATEST_REQUEST_WORKER_H
@@ -0,0 +1,114 @@
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+#include <cstddef> // size_t
+#include <list>
+#include <unordered_map>
+#include <utility> // move, pair
+
+// A small cache holding up to a number of values, evicting the least recently used one.
+// Not thread-safe.
+template <class Key, class Value>
+class LruCache
+{
+   public:
+
+   explicit LruCache(std::size_t capacity = 0) : capacity{capacity} {}
+
+   // Copy the value to value if it is cached and make it the most recently used one.
+   bool get(const Key&, Value& value);
+
+   bool contains(const Key&) const;
+
+   void put(const Key&, Value);
+
+   void erase(const Key&);
+
+   // Evicts values if there are more than the new capacity.
+   void setCapacity(std::size_t);
+   std::size_t getCapacity() const;
+
+   void clear();
+
+   private:
+
+   typedef std::list<std::pair<Key, Value>> List;
+
+   std::size_t capacity;
+   List entries; // most recently used first
+   std::unordered_map<Key, typename List::iterator> positions;
+};
+
+template <class Key, class Value>
+bool LruCache<Key, Value>::get(const Key& key, Value& value)
+{
+   auto found = positions.find(key);
+   if (found == positions.end()) {
+      return false;
+   }
+   entries.splice(entries.begin(), entries, found->second);
+   value = found->second->second;
+   return true;
+}
+
+template <class Key, class Value>
+bool LruCache<Key, Value>::contains(const Key& key) const
+{
+   return positions.count(key);
+}
+
+template <class Key, class Value>
+void LruCache<Key, Value>::put(const Key& key, Value value)
+{
+   auto found = positions.find(key);
+   if (found != positions.end())
+   {
+      found->second->second = std::move(value);
+      entries.splice(entries.begin(), entries, found->second);
+      return;
+   }
+   if (!capacity) {
+      return;
+   }
+
+   entries.emplace_front(key, std::move(value));
+   positions[key] = entries.begin();
+   setCapacity(capacity);
+}
+
+template <class Key, class Value>
+void LruCache<Key, Value>::erase(const Key& key)
+{
+   auto found = positions.find(key);
+   if (found != positions.end())
+   {
+      entries.erase(found->second);
+      positions.erase(found);
+   }
+}
+
+template <class Key, class Value>
+void LruCache<Key, Value>::setCapacity(std::size_t capacity)
+{
+   this->capacity = capacity;
+   while (entries.size() > capacity)
+   {
+      positions.erase(entries.back().first);
+      entries.pop_back();
+   }
+}
+
+template <class Key, class Value>
+std::size_t LruCache<Key, Value>::getCapacity() const
+{
+   return capacity;
+}
+
+template <class Key, class Value>
+void LruCache<Key, Value>::clear()
+{
+   entries.clear();
+   positions.clear();
+}
+
+#endif //LRU_CACHE_H
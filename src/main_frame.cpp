@@ -1,6 +1,6 @@
 #include "main_frame.hpp"
 
-#include <algorithm>  // lower_bound
+#include <algorithm>  // lower_bound, max, min, remove_if
 #include <cassert>
 #include <fstream>    // ofstream
 #include <functional> // bind
@@ -9,15 +9,30 @@
 #include <string>
 
 #include <wx/aboutdlg.h>    // wxAboutBox()
+#include <wx/app.h>         // wxWakeUpIdle()
+#include <wx/choicdlg.h>    // wxGetSingleChoiceIndex()
+#include <wx/config.h>      // wxConfigBase
 #include <wx/dcmemory.h>    // wxMemoryDC
 #include <wx/filehistory.h> // wxFileHistory
+#include <wx/filedlg.h>     // wxFileSelector()
 #include <wx/filename.h>    // wxFileName
+#include <wx/msgdlg.h>      // wxMessageBox()
+#include <wx/numdlg.h>      // wxGetNumberFromUser()
+#include <wx/progdlg.h>     // wxProgressDialog
 #include <wx/rawbmp.h>
 #include <wx/stdpaths.h>    // wxStandardPaths
 
+#include "batch_reader.hpp"
 #include "bitmap.hpp"
+#include "bitmap_pool.hpp"
 #include "create_bitmaps.hpp"
+#include "directory_source.hpp"
+#include "expand_gray.hpp"
+#include "memory_source.hpp"
 #include "open_movie_wizard.hpp"
+#include "packed_movie.hpp"
+#include "phase_source.hpp"
+#include "stream_source.hpp"
 #include "track_panel.hpp"
 #include "trackee_box.hpp"
 
@@ -26,8 +41,43 @@
 
 // weakly typed enum because implicit conversion is convenient
 enum mainFrameId : unsigned { myID_TRACKEEBOX = wxID_HIGHEST, myID_LINKBOX, myID_TRACK,
+   myID_OPEN_LIVE, myID_OPEN_FILE, myID_PACK_MOVIE,
    myID_DELETE_TRACKEE, myID_REMOVE_LINK };
 
+namespace {
+   // read from the configuration file
+   std::size_t frameCacheBudget();
+   std::size_t compressedStoreBudget();
+   std::size_t nativeBitmapBudget();
+   unsigned loaderThreadCount();
+   std::shared_ptr<DiskCache> makeDiskCache();
+   void configureBitmapPool();
+   void configureBatchReader();
+
+   // Ask for the size of the frames of a raw stream or of raw phase images; false if the
+   // user cancels.
+   bool askRawFormat(wxWindow* parent, StreamSource::RawFormat&);
+   bool askPhaseFormat(wxWindow* parent, PhaseSource::Format&);
+   PhaseSource::Range phaseRange();
+
+   // the payload of a myEVT_FRAME_PREPARED event
+   struct PreparedFrame
+   {
+      std::size_t index;
+      unsigned long generation;
+      wxImage image;  // null if only the scaled one was asked for
+      wxImage scaled; // to the size of the trackPanel; may be null
+   };
+
+   // the payload of a myEVT_PYRAMID_BUILT event
+   struct BuiltPyramid
+   {
+      std::size_t index;
+      unsigned long generation;
+      std::shared_ptr<const Pyramid> pyramid;
+   };
+}
+
 //// <_constructors_> ////
 ///
 MainFrame::MainFrame(const wxPoint& pos, const wxSize& size) :
@@ -46,18 +96,43 @@ MainFrame::MainFrame(const wxPoint& pos, const wxSize& size) :
    trackPanel{new TrackPanel{topPanel}},
    movieSlider{new wxSlider{topPanel, wxID_ANY, 0, 0, 2, wxDefaultPosition, wxDefaultSize,
       wxSL_LABELS}},
-   panelUpdateTimer{this},
-   marks{}, movie{}, tracker{}, trackees{}
+   panelUpdateTimer{this}, convertTimer{},
+   marks{}, diskCache{makeDiskCache()}, movie{}, pendingMovie{}, live{false},
+   pendingLive{false}, scanningSource{nullptr},
+   scanGeneration{0}, scanGenerations{0}, displayedIndex{0}, shownIndex{0},
+   nativeBitmaps{}, toConvert{}, convertPolls{0},
+   framePreparer{[this](std::size_t index, unsigned long generation, wxImage& image,
+         wxImage& scaled) {
+         wxThreadEvent* event = new wxThreadEvent{myEVT_FRAME_PREPARED};
+         event->SetPayload(PreparedFrame{index, generation, image, scaled});
+         image = scaled = wxImage{}; // Only the event refers to the images now.
+         QueueEvent(event);
+      }
+   },
+   pyramidBuilder{[this](std::size_t index, unsigned long generation,
+         std::shared_ptr<const Pyramid> pyramid) {
+         wxThreadEvent* event = new wxThreadEvent{myEVT_PYRAMID_BUILT};
+         event->SetPayload(BuiltPyramid{index, generation, std::move(pyramid)});
+         QueueEvent(event);
+      }
+   },
+   movieGeneration{0}, prefetcher{}, tracker{}, trackFrom{0}, trackees{}
 {
-   {
-      wxFileName splashFileName{wxStandardPaths::Get().GetUserDataDir().ToStdString(),
-         "track_hack_splash_", ""};
+   configureBitmapPool();
+   configureBatchReader();
 
-      createBitmaps<3>(splashFileName.GetFullPath().ToStdString());
-      movie = std::unique_ptr<Movie>{new Movie{splashFileName.GetPath().ToStdString(),
-         "track_hack_splash_[0-9]{2}\\.bmp"}};
+   {
+      // Rendered in memory; nothing is read or written.
+      std::vector<std::string> names{"track_hack_splash_00.bmp",
+         "track_hack_splash_01.bmp", "track_hack_splash_02.bmp"};
+      std::unique_ptr<FrameSource> source{new MemorySource{
+         wxStandardPaths::Get().GetUserDataDir().ToStdString(), createBitmaps<3>(),
+         std::move(names)}};
+      movie = std::unique_ptr<Movie>{new Movie{std::move(source), frameCacheBudget(),
+         loaderThreadCount()}};
 
       if (!movie->getSize()) throw "CURSE IT!";
+      resetNativeBitmaps();
    }
 
    //// <_..._> ////
@@ -83,6 +158,12 @@ MainFrame::MainFrame(const wxPoint& pos, const wxSize& size) :
    // accelerator strings in the following menu items magically work all by themselves.
    fileMenu->Append(wxID_OPEN, "&Open\tCtrl+O", "Load a movie composed of grayscale "
       "bitmaps");
+   fileMenu->Append(myID_OPEN_LIVE, "Open &live...", "Load a movie that is still being "
+      "recorded into a directory and track its frames as they arrive");
+   fileMenu->Append(myID_OPEN_FILE, "Open &file...\tCtrl+Shift+O", "Load a movie packed "
+      "into a single file");
+   fileMenu->Append(myID_PACK_MOVIE, "&Pack movie...", "Save the current movie as a "
+      "single memory-mappable file");
    fileMenu->AppendSeparator();
    fileMenu->Append(wxID_SAVE, "&Save image\tCtrl+S", "Save an image of the panel below");
    fileMenu->AppendSeparator();
@@ -129,7 +210,7 @@ MainFrame::MainFrame(const wxPoint& pos, const wxSize& size) :
    CreateStatusBar(1, wxSTB_SIZEGRIP | wxSTB_SHOW_TIPS | wxSTB_ELLIPSIZE_START |
       wxFULL_REPAINT_ON_RESIZE);
 
-   trackPanel->setBitmap(getBitmap(0));
+   displayFrame(0);
    SetStatusText(movie->getFilename(0));
 
    //// <_event_handler_mappings_> ////
@@ -146,12 +227,18 @@ MainFrame::MainFrame(const wxPoint& pos, const wxSize& size) :
 
    Bind(myEVT_TRACKPANEL_MARKED, &MainFrame::onTrackPanelMarked, this, wxID_ANY);
    trackPanel->Bind(myEVT_TRACKPANEL_SAVE, &MainFrame::onTrackPanelSave, this);
+   trackPanel->Bind(myEVT_TRACKPANEL_ZOOMED, &MainFrame::onTrackPanelZoomed, this);
+   trackPanel->Bind(myEVT_TRACKPANEL_RESIZED, &MainFrame::onTrackPanelResized, this);
+   trackPanel->Bind(myEVT_TRACKPANEL_PICKED, &MainFrame::onTrackPanelPicked, this);
 
    Bind(wxEVT_SCROLL_THUMBTRACK, &MainFrame::onScrollThumbtrack, this, wxID_ANY);
    Bind(wxEVT_SCROLL_CHANGED, &MainFrame::onScrollChanged, this, wxID_ANY);
    Bind(wxEVT_COMMAND_SLIDER_UPDATED, &MainFrame::onSlider, this, wxID_ANY);
 
    Bind(wxEVT_COMMAND_MENU_SELECTED, &MainFrame::onOpen, this, wxID_OPEN);
+   Bind(wxEVT_COMMAND_MENU_SELECTED, &MainFrame::onOpenLive, this, myID_OPEN_LIVE);
+   Bind(wxEVT_COMMAND_MENU_SELECTED, &MainFrame::onOpenFile, this, myID_OPEN_FILE);
+   Bind(wxEVT_COMMAND_MENU_SELECTED, &MainFrame::onPackMovie, this, myID_PACK_MOVIE);
    Bind(wxEVT_COMMAND_MENU_SELECTED, &MainFrame::onSaveImage, this, wxID_SAVE);
    Bind(wxEVT_COMMAND_MENU_SELECTED, &MainFrame::onTrack, this, myID_TRACK);
    Bind(wxEVT_COMMAND_MENU_SELECTED, &MainFrame::onDeleteTrackee, this,
@@ -165,10 +252,17 @@ MainFrame::MainFrame(const wxPoint& pos, const wxSize& size) :
    Bind(wxEVT_COMMAND_MENU_SELECTED, &MainFrame::onOneThroughThree, this, myID_ONE_THREE);
 
    Bind(myEVT_TRACKING_COMPLETED, &MainFrame::onTrackingCompleted, this, wxID_ANY);
+   Bind(myEVT_MOVIE_GROWN, &MainFrame::onMovieGrown, this, wxID_ANY);
+   Bind(myEVT_FRAME_PREPARED, &MainFrame::onFramePrepared, this, wxID_ANY);
+   Bind(myEVT_PYRAMID_BUILT, &MainFrame::onPyramidBuilt, this, wxID_ANY);
 
    Bind(wxEVT_CLOSE_WINDOW, &MainFrame::onClose, this);
 
    Bind(wxEVT_TIMER, &MainFrame::onTimer, this);
+   Bind(wxEVT_IDLE, &MainFrame::onIdle, this);
+
+   // An idle event follows, even if nothing else happens.
+   convertTimer.Bind(wxEVT_TIMER, [](wxTimerEvent&) { wxWakeUpIdle(); });
    ///
    //// </_event_handler_mappings_> ////
 }
@@ -179,7 +273,14 @@ MainFrame::MainFrame(const wxPoint& pos, const wxSize& size) :
 ///
 wxThread::ExitCode MainFrame::Entry()
 {
-   tracker.track(trackees, *movie);
+   if (trackFrom) {
+      for (auto& pair : trackees) {
+         tracker.trackOn(std::get<1>(pair), *movie, trackFrom);
+      }
+   }
+   else {
+      tracker.track(trackees, *movie);
+   }
 
    // processed during the next event loop iteration
    QueueEvent(new wxThreadEvent{myEVT_TRACKING_COMPLETED});
@@ -275,7 +376,7 @@ void MainFrame::onMarkBoxSelected(wxCommandEvent& event)
    auto trackeeKey = trackeeBox->getStringSelection().ToStdString();
    movieSlider->SetValue(marks[trackeeKey][event.GetSelection()]); // doesn't generate an
                                                                    // event.
-   trackPanel->setBitmap(getBitmap(movieSlider->GetValue()));
+   displayFrame(movieSlider->GetValue());
    trackPanel->focusIndex(movieSlider->GetValue());
 
    GetMenuBar()->Enable(myID_REMOVE_LINK, true);
@@ -364,6 +465,31 @@ void MainFrame::onTrackPanelSave(wxCommandEvent&)
    saveImage();
 }
 
+void MainFrame::onTrackPanelZoomed(wxCommandEvent&)
+{
+   requestPyramid();
+}
+
+void MainFrame::onTrackPanelResized(wxCommandEvent&)
+{
+   // While another frame is being prepared, it's scaled to the new size when it's shown.
+   if (movie && shownIndex == displayedIndex)
+   {
+      framePreparer.request(*movie, shownIndex, movieGeneration,
+         trackPanel->GetClientSize(), false);
+   }
+}
+
+// Select the trackee whose track was picked and go to the frame of the picked point.
+void MainFrame::onTrackPanelPicked(wxCommandEvent& event)
+{
+   if (!trackeeBox->selectTrackee(event.GetString().ToStdString())) {
+      return;
+   }
+   movieSlider->SetValue(event.GetInt()); // doesn't generate an event
+   onSlider(event); // It doesn't look at the event.
+}
+
 void MainFrame::onScrollChanged(wxScrollEvent& /*event*/)
 {
    // topPanel->Layout() would be necessary but all bitmaps in a movie are required to be
@@ -371,14 +497,20 @@ void MainFrame::onScrollChanged(wxScrollEvent& /*event*/)
    //trackPanel->setBitmap(getBitmap(event.GetPosition()));
 }
 
-void MainFrame::onScrollThumbtrack(wxScrollEvent& /*event*/)
+void MainFrame::onScrollThumbtrack(wxScrollEvent& event)
 {
-   //trackPanel->setBitmap(getBitmap(event.GetPosition()));
+   // Follow the thumb while it's dragged; frames that aren't decoded yet are prepared in
+   // the background, so this returns right away.
+   if (std::size_t(event.GetPosition()) != displayedIndex) {
+      displayFrame(event.GetPosition());
+   }
 }
 
 void MainFrame::onSlider(wxCommandEvent&)
 {
-   trackPanel->setBitmap(getBitmap(movieSlider->GetValue()));
+   if (std::size_t(movieSlider->GetValue()) != displayedIndex) {
+      displayFrame(movieSlider->GetValue());
+   }
    {
       // ...
       std::vector<std::size_t>& marks =
@@ -400,6 +532,16 @@ void MainFrame::onSlider(wxCommandEvent&)
 }
 
 void MainFrame::onOpen(wxCommandEvent&)
+{
+   openDirectory(false);
+}
+
+void MainFrame::onOpenLive(wxCommandEvent&)
+{
+   openDirectory(true);
+}
+
+void MainFrame::openDirectory(bool live)
 {
    wxString dir, regEx;
 
@@ -413,55 +555,210 @@ void MainFrame::onOpen(wxCommandEvent&)
       dirHistory.AddFileToHistory(dir);
       dirHistory.Save(*wxConfigBase::Get());
 
-      std::unique_ptr<Movie> newMovie{new Movie{dir.ToStdString(), regEx.ToStdString()}};
+      // The directory is scanned in the background; the movie replaces the current one
+      // once it has two frames (see updateMovie()).
+      const unsigned long generation = ++scanGenerations;
+      std::unique_ptr<DirectorySource> source{new DirectorySource{dir.ToStdString(),
+         regEx.ToStdString(), diskCache, growthListener(generation), live}};
+      const DirectorySource* scanning = source.get();
+      std::unique_ptr<Movie> newMovie{new Movie{std::move(source), frameCacheBudget(),
+         loaderThreadCount(), compressedStoreBudget()}};
+
+      // Only now is the scan that may still be running abandoned.
+      scanGeneration = generation;
+      scanningSource = scanning;
+      pendingMovie = std::move(newMovie);
+      pendingLive = live;
+
+      SetStatusText("Scanning " + dir + "...");
+   }
+}
 
-      if (newMovie->getSize() > 1) // And selected a movie with at least two frames.
-      {
-         movie = std::move(newMovie);
+void MainFrame::onOpenFile(wxCommandEvent&)
+{
+   wxString fileName = wxFileSelector("Open a movie file", wxEmptyString, wxEmptyString,
+      "thm", "Movie files (*.thm;*.tif;*.tiff;*.y4m;*.raw;*.bin)|"
+      "*.thm;*.tif;*.tiff;*.y4m;*.raw;*.bin|"
+      "Packed movies (*.thm)|*.thm|TIFF stacks (*.tif;*.tiff)|*.tif;*.tiff|"
+      "YUV4MPEG2 streams (*.y4m)|*.y4m|Raw 8-bit grayscale streams (*.raw)|*.raw|"
+      "Raw phase images (*.bin)|*.bin",
+      wxFD_OPEN | wxFD_FILE_MUST_EXIST, this);
+
+   if (fileName.empty()) return;
+
+   const wxString extension = wxFileName{fileName}.GetExt().Lower();
+   StreamSource::RawFormat rawFormat;
+   PhaseSource::Format phaseFormat;
+   if ((extension == "raw" && !askRawFormat(this, rawFormat)) ||
+       (extension == "bin" && !askPhaseFormat(this, phaseFormat)))
+   {
+      return;
+   }
 
-         GetMenuBar()->Enable(myID_TRACK, false);
-         GetMenuBar()->Enable(myID_DELETE_TRACKEE, false);
-         GetMenuBar()->Enable(myID_REMOVE_LINK, false);
-         trackeeBox->reset();
-         trackeeBox->SetFocus();
-         markBox->Clear();
-         markBox->Hide();
-         trackPanel->reset();
+   try {
+      const unsigned long generation = ++scanGenerations;
 
-         marks.clear();
-         trackees.clear();
+      // Streams may still be recorded to; they grow like scanned directories, and until
+      // they have two frames the current movie stays.
+      std::unique_ptr<FrameSource> source;
+      bool stream = true;
+      if (extension == "y4m") {
+         source.reset(new StreamSource{fileName.ToStdString(),
+            growthListener(generation)});
+      }
+      else if (extension == "raw") {
+         source.reset(new StreamSource{fileName.ToStdString(), rawFormat,
+            growthListener(generation)});
+      }
+      else if (extension == "bin")
+      {
+         // one file per frame; the chosen file's siblings with the same extension
+         source.reset(new PhaseSource{wxFileName{fileName}.GetPath().ToStdString(),
+            "(?i)\\.bin$", phaseFormat, phaseRange()});
+         stream = false;
+      }
+      else {
+         source = openFrameSource(fileName.ToStdString());
+         stream = false;
+      }
 
-         movieSlider->SetRange(0, movie->getSize() - 1);
-         movieSlider->SetValue(0); // does not post or queue an event
-         trackPanel->setBitmap(getBitmap(0));
-         SetStatusText(movie->getFilename(0));
+      std::unique_ptr<Movie> newMovie{new Movie{std::move(source), frameCacheBudget(),
+         loaderThreadCount(), compressedStoreBudget()}};
+      if (!stream && newMovie->getSize() < 2)
+      {
+         // Keep the current movie and any scan still running, as if nothing was
+         // selected.
+         SetStatusText("No movie found in " + fileName);
+         return;
+      }
 
-         // First, invoke the sizer-based layout algorithm for topPanel, THEN cause
-         // movieSlider to be repainted.
-         topPanel->Layout();       // Somehow repainting only movieSlider
-                                   // (movieSlider->Refresh()) is not enough to fix it but
-         topPanel->Refresh(false); // most of topPanels other children have to be
-                                   // repainted anyway.
+      // Ignore the rest of a scan that may still be running.
+      scanGeneration = generation;
+      scanningSource = nullptr;
+      if (newMovie->getSize() < 2) {
+         pendingMovie = std::move(newMovie);
+         pendingLive = true;
+         SetStatusText("Waiting for frames of " + fileName + "...");
+      }
+      else {
+         pendingMovie.reset();
+         setMovie(std::move(newMovie), stream);
       }
    }
+   catch (const std::exception& exception) {
+      wxMessageBox(exception.what(), "Error", wxOK | wxICON_ERROR, this);
+   }
 }
 
-void MainFrame::onSaveImage(wxCommandEvent&)
+void MainFrame::onPackMovie(wxCommandEvent&)
 {
-   saveImage();
+   wxString fileName = wxFileSelector("Pack movie", movie->getDir(), "movie.thm", "thm",
+      "Packed movies (*.thm)|*.thm", wxFD_SAVE | wxFD_OVERWRITE_PROMPT, this);
+
+   if (fileName.empty()) return;
+
+   wxProgressDialog progressDialog{"Pack movie", "Writing " + fileName,
+      int(movie->getSize()), this, wxPD_APP_MODAL | wxPD_CAN_ABORT | wxPD_AUTO_HIDE |
+      wxPD_ELAPSED_TIME | wxPD_REMAINING_TIME};
+
+   try {
+      packMovie(*movie, fileName.ToStdString(), true, [&](std::size_t written) {
+         return progressDialog.Update(int(written));
+      });
+   }
+   catch (const std::exception& exception) {
+      wxMessageBox(exception.what(), "Error", wxOK | wxICON_ERROR, this);
+   }
 }
 
-void MainFrame::onTrack(wxCommandEvent&)
+std::function<void(bool)> MainFrame::growthListener(unsigned long generation)
 {
-   assert (!trackees.empty());
+   return [this, generation](bool complete) {
+      wxThreadEvent* event = new wxThreadEvent{myEVT_MOVIE_GROWN};
+      event->SetInt(complete);
+      event->SetExtraLong(generation);
+      QueueEvent(event);
+   };
+}
 
-   if (CreateThread(wxTHREAD_JOINABLE) != wxTHREAD_NO_ERROR) {
+void MainFrame::updateMovie()
+{
+   // The tracker's tracks have to stay as long as the movie while it's running.
+   if (GetThread() && GetThread()->IsRunning()) {
       return;
    }
-   if (GetThread()->Run() != wxTHREAD_NO_ERROR) {
+
+   if (pendingMovie)
+   {
+      if (pendingMovie->update() > 1) {
+         setMovie(std::move(pendingMovie), pendingLive);
+      }
       return;
    }
 
+   // Frames rewritten after they were shown (e.g. ones that were still being written)
+   // are converted again.
+   std::vector<std::size_t> rewritten;
+   const std::size_t oldSize = movie->getSize();
+   const std::size_t newSize = movie->update(&rewritten);
+   for (std::size_t i : rewritten)
+   {
+      nativeBitmaps.erase(i);
+      if (i == displayedIndex) displayFrame(i);
+   }
+
+   if (newSize > oldSize)
+   {
+      for (auto& pair : trackees) {
+         std::get<1>(pair).resize(movie->getSize());
+      }
+      movieSlider->SetRange(0, movie->getSize() - 1);
+
+      if (live)
+      {
+         trackNewFrames(oldSize);
+
+         // Keep up with the recording if the last frame was shown.
+         if (std::size_t(movieSlider->GetValue()) + 1 == oldSize)
+         {
+            const std::size_t last = movie->getSize() - 1;
+            movieSlider->SetValue(last); // does not post or queue an event
+            displayFrame(last);
+            trackPanel->focusIndex(last);
+            SetStatusText(movie->getFilename(last));
+         }
+         trackPanel->Refresh(false);
+      }
+   }
+}
+
+void MainFrame::trackNewFrames(std::size_t oldSize)
+{
+   if (!oldSize) return;
+
+   for (const auto& pair : trackees)
+   {
+      std::shared_ptr<const Track> track = std::get<1>(pair).getTrack().lock();
+      if ((*track)[oldSize - 1] != Point{-1, -1})
+      {
+         // Only the new frames are tracked; the trackees without a point at the old end
+         // are skipped by Tracker::trackOn().
+         trackFrom = oldSize;
+         if (!startTracking()) trackFrom = 0;
+         return;
+      }
+   }
+}
+
+bool MainFrame::startTracking()
+{
+   if (CreateThread(wxTHREAD_JOINABLE) != wxTHREAD_NO_ERROR) {
+      return false;
+   }
+   if (GetThread()->Run() != wxTHREAD_NO_ERROR) {
+      return false;
+   }
+
    //trackPanel->SetEvtHandlerEnabled(false);
    trackeeBox->Disable();
    trackPanel->Disable();
@@ -472,6 +769,132 @@ void MainFrame::onTrack(wxCommandEvent&)
 
    // Call onTimer() every 500 milliseconds to refresh the TrackPanel.
    panelUpdateTimer.Start(500);
+   return true;
+}
+
+void MainFrame::setMovie(std::unique_ptr<Movie> newMovie, bool live)
+{
+   if (newMovie->getSize() > 1) // Only accept movies with at least two frames.
+   {
+      framePreparer.cancel();
+      pyramidBuilder.cancel();
+      ++movieGeneration;
+      movie = std::move(newMovie);
+      this->live = live;
+      displayedIndex = 0;
+      resetNativeBitmaps();
+      prefetcher.reset();
+
+      GetMenuBar()->Enable(myID_TRACK, false);
+      GetMenuBar()->Enable(myID_DELETE_TRACKEE, false);
+      GetMenuBar()->Enable(myID_REMOVE_LINK, false);
+      trackeeBox->reset();
+      trackeeBox->SetFocus();
+      markBox->Clear();
+      markBox->Hide();
+      trackPanel->reset();
+
+      marks.clear();
+      trackees.clear();
+
+      movieSlider->SetRange(0, movie->getSize() - 1);
+      movieSlider->SetValue(0); // does not post or queue an event
+      displayFrame(0);
+      SetStatusText(movie->getFilename(0));
+
+      // First, invoke the sizer-based layout algorithm for topPanel, THEN cause
+      // movieSlider to be repainted.
+      topPanel->Layout();       // Somehow repainting only movieSlider
+                                // (movieSlider->Refresh()) is not enough to fix it but
+      topPanel->Refresh(false); // most of topPanels other children have to be
+                                // repainted anyway.
+   }
+}
+
+void MainFrame::onMovieGrown(wxThreadEvent& event)
+{
+   if (event.GetExtraLong() != long(scanGeneration)) {
+      return; // from a scan that was abandoned
+   }
+
+   updateMovie();
+
+   if (event.GetInt()) // The scan is complete.
+   {
+      const bool tooShort = pendingMovie && pendingMovie->update() < 2;
+      if (tooShort && pendingLive) {
+         SetStatusText("Waiting for frames...");
+      }
+      else if (tooShort)
+      {
+         // Keep the current movie, as if nothing was selected.
+         pendingMovie.reset();
+         SetStatusText("No movie found");
+      }
+      else
+      {
+         const DirectorySource::ScanStats scanStats = scanningSource->getScanStats();
+
+         std::stringstream sStream;
+         sStream << scanStats.matched << " of " << scanStats.files << " files "
+            "matched, sorted by " << (scanStats.byIndex ? "index" : "name") << " in " <<
+            long(scanStats.seconds * 1000.) << " ms";
+         SetStatusText(sStream.str());
+      }
+      scanningSource = nullptr;
+   }
+}
+
+void MainFrame::onFramePrepared(wxThreadEvent& event)
+{
+   const PreparedFrame frame = event.GetPayload<PreparedFrame>();
+   if (frame.generation != movieGeneration || frame.index != displayedIndex) {
+      return; // The user moved on.
+   }
+
+   if (frame.image.IsOk())
+   {
+      wxBitmap nativeBitmap{frame.image};
+      nativeBitmaps.put(frame.index, nativeBitmap);
+      trackPanel->setBitmap(nativeBitmap);
+      shownIndex = frame.index;
+      requestPyramid();
+   }
+   // The panel may have been resized while the frame was prepared.
+   const wxSize size = trackPanel->GetClientSize();
+   if (frame.index == shownIndex && frame.scaled.IsOk() && frame.scaled.GetSize() == size)
+   {
+      trackPanel->setScaledImage(frame.scaled);
+   }
+   else if (frame.index == shownIndex && size.GetWidth() > 0 && size.GetHeight() > 0) {
+      framePreparer.request(*movie, shownIndex, movieGeneration, size, false);
+   }
+   trackPanel->Refresh(false);
+}
+
+void MainFrame::onPyramidBuilt(wxThreadEvent& event)
+{
+   const BuiltPyramid built = event.GetPayload<BuiltPyramid>();
+   if (built.generation != movieGeneration || built.index != shownIndex ||
+       shownIndex != displayedIndex)
+   {
+      return; // The user moved on.
+   }
+
+   trackPanel->setPyramid(built.pyramid);
+   trackPanel->Refresh(false);
+}
+
+void MainFrame::onSaveImage(wxCommandEvent&)
+{
+   saveImage();
+}
+
+void MainFrame::onTrack(wxCommandEvent&)
+{
+   assert (!trackees.empty());
+
+   startTracking();
 }
 
 // Called when we want to delete a trackee.
@@ -581,49 +1004,55 @@ void MainFrame::onTrackingCompleted(wxThreadEvent&)
 {
    assert (!trackees.empty());
 
+   GetThread()->Wait(); // It has nothing left to do but return.
    panelUpdateTimer.Stop();
 
+   // Only tracks the user asked for are written, not each live frame tracked on.
+   if (!trackFrom)
    {
-      std::ofstream oStream{movie->getDir() + "all_tracks.txt"}; // RAII
-
-      oStream << "File name";
-
-      for (const auto& pair : trackees)
       {
-         const std::string key = std::get<0>(pair);
-         oStream << '\t' << key << " (x)\t" << key << " (y)";
-      }
-      oStream << '\n';
+         std::ofstream oStream{movie->getDir() + "all_tracks.txt"}; // RAII
 
-      for (std::size_t i = 0; i < movie->getSize(); ++i)
-      {
-         oStream << movie->getFrame(i).getFilename();
+         oStream << "File name";
 
          for (const auto& pair : trackees)
          {
-            const Trackee trackee = std::get<1>(pair);
-            std::shared_ptr<const Track> track = trackee.getTrack().lock();
-            oStream << '\t' << (*track)[i].x << '\t' << (*track)[i].y;
+            const std::string key = std::get<0>(pair);
+            oStream << '\t' << key << " (x)\t" << key << " (y)";
          }
          oStream << '\n';
+
+         for (std::size_t i = 0; i < movie->getSize(); ++i)
+         {
+            oStream << movie->getName(i);
+
+            for (const auto& pair : trackees)
+            {
+               const Trackee trackee = std::get<1>(pair);
+               std::shared_ptr<const Track> track = trackee.getTrack().lock();
+               oStream << '\t' << (*track)[i].x << '\t' << (*track)[i].y;
+            }
+            oStream << '\n';
+         }
       }
-   }
 
-   for (const auto& pair : trackees)
-   {
-      const std::string key = std::get<0>(pair);
-      const Trackee trackee = std::get<1>(pair);
+      for (const auto& pair : trackees)
+      {
+         const std::string key = std::get<0>(pair);
+         const Trackee trackee = std::get<1>(pair);
 
-      std::shared_ptr<const Track> track = trackee.getTrack().lock();
+         std::shared_ptr<const Track> track = trackee.getTrack().lock();
 
-      std::ofstream oStream{movie->getDir() + key + "_track.txt"};
+         std::ofstream oStream{movie->getDir() + key + "_track.txt"};
 
-      for (std::size_t i = 0; i < movie->getSize(); ++i)
-      {
-         oStream << movie->getFrame(i).getFilename() << '\t' << (*track)[i].x << '\t' <<
-            (*track)[i].y << '\n';
+         for (std::size_t i = 0; i < movie->getSize(); ++i)
+         {
+            oStream << movie->getName(i) << '\t' << (*track)[i].x << '\t' <<
+               (*track)[i].y << '\n';
+         }
       }
    }
+   trackFrom = 0;
 
    trackeeBox->Enable();
    trackPanel->Enable();
@@ -637,6 +1066,8 @@ void MainFrame::onTrackingCompleted(wxThreadEvent&)
    }
 
    trackPanel->Refresh(false);
+
+   updateMovie(); // Take in frames found while tracking.
 }
 
 void MainFrame::onClose(wxCloseEvent& event)
@@ -653,6 +1084,38 @@ void MainFrame::onTimer(wxTimerEvent&)
 {
    trackPanel->Refresh(false);
 }
+
+void MainFrame::onIdle(wxIdleEvent& event)
+{
+   // Frames shown or converted meanwhile are done with.
+   toConvert.erase(std::remove_if(toConvert.begin(), toConvert.end(),
+         [this](std::size_t i) {
+            return i >= movie->getSize() || nativeBitmaps.contains(i);
+         }
+      ), toConvert.end());
+
+   // One at a time, nearest first, so the user isn't kept waiting.
+   for (auto i = toConvert.begin(); i != toConvert.end(); ++i)
+   {
+      if (movie->getBitmap(*i, false))
+      {
+         getBitmap(*i);
+         toConvert.erase(i);
+         convertPolls = 0;
+         if (!toConvert.empty()) event.RequestMore();
+         return;
+      }
+   }
+
+   // The rest are still being decoded.  Look again shortly instead of keeping the
+   // processor busy with idle events, for two seconds at most: a frame may have been
+   // evicted before it was converted.
+   if (!toConvert.empty() && !convertTimer.IsRunning() && convertPolls < 40)
+   {
+      ++convertPolls;
+      convertTimer.Start(50, wxTIMER_ONE_SHOT);
+   }
+}
 ///
 //// </_event_handler_definitions> ////
 
@@ -729,7 +1192,7 @@ void MainFrame::saveImage()
       wxMemoryDC dC{bitmap};
       wxGraphicsContext *gC = wxGraphicsContext::Create(dC);
       gC->SetInterpolationQuality(wxINTERPOLATION_BEST);
-      trackPanel->draw(gC);
+      trackPanel->draw(gC, true);
       delete gC;
       dC.SelectObject(wxNullBitmap);
       bitmap.SaveFile(filename, wxBITMAP_TYPE_BMP);
@@ -738,49 +1201,246 @@ void MainFrame::saveImage()
 
 wxBitmap MainFrame::getBitmap(std::size_t index)
 {
-   //std::shared_ptr<const Bitmap> bitmap = movie.getFrame(index).getBitmap(false);
-   std::shared_ptr<const Bitmap> bitmap = movie->getFrame(index).getBitmap(true);
    wxBitmap nativeBitmap;
+   if (nativeBitmaps.get(index, nativeBitmap)) {
+      return nativeBitmap;
+   }
 
-   if (bitmap)
+   std::shared_ptr<const Bitmap> bitmap = movie->getBitmap(index);
+   if (bitmap && nativeBitmap.Create(bitmap->width, bitmap->height, 24))
    {
-      nativeBitmap.Create(bitmap->width, bitmap->height, 24);
+      // Expand whole rows at once rather than pixel by pixel through the iterator.
       wxNativePixelData pixelData{nativeBitmap};
-      wxNativePixelData::Iterator iterator{pixelData};
-
+      wxNativePixelData::Iterator rowStart{pixelData};
       for (std::size_t row = 0; row < bitmap->height; ++row)
       {
-         iterator.MoveTo(pixelData, 0, row);
-         for (std::size_t column = 0; column < bitmap->width; ++column)
-         {
-            iterator.Red() = iterator.Green() = iterator.Blue() = (*bitmap)[row][column];
-            ++iterator;
-         }
+         expandGray((*bitmap)[row], bitmap->width, rowStart.m_ptr,
+            wxNativePixelFormat::SizePixel);
+         rowStart.OffsetY(pixelData, 1);
       }
+      nativeBitmaps.put(index, nativeBitmap);
+   }
+   return nativeBitmap;
+}
+
+void MainFrame::resetNativeBitmaps()
+{
+   nativeBitmaps.clear();
+   toConvert.clear();
+
+   std::size_t frameBytes = 1;
+   if (auto bitmap = movie->getBitmap(0)) {
+      frameBytes = std::max<std::size_t>(bitmap->width * bitmap->height *
+         wxNativePixelFormat::SizePixel, 1);
    }
-   /*else
+   nativeBitmaps.setCapacity(std::max<std::size_t>(nativeBitmapBudget() / frameBytes, 2));
+}
+
+void MainFrame::displayFrame(std::size_t index)
+{
+   // Get the loader threads going before decoding on this thread (if necessary).  The
+   // nearest prefetched frames are converted to native bitmaps when the application is
+   // idle, leaving room for the frames shown recently.
+   const std::vector<std::size_t> prefetched = prefetcher.update(index,
+      movie->getSize());
+   movie->prefetch(prefetched);
+   toConvert.assign(prefetched.begin(), prefetched.begin() +
+      std::min(prefetched.size(), nativeBitmaps.getCapacity() / 2));
+   convertPolls = 0;
+
+   movie->unpin(displayedIndex);
+   movie->pin(index);
+   displayedIndex = index;
+
+   if (nativeBitmaps.contains(index) || movie->getBitmap(index, false))
    {
-      nativeBitmap.LoadFile(movie.getFilename(index), wxBITMAP_TYPE_ANY);
-      wxNativePixelData pixelData{nativeBitmap};
-      wxNativePixelData::Iterator iterator{pixelData};
+      trackPanel->setBitmap(getBitmap(index));
+      shownIndex = index;
+      requestPyramid();
+      framePreparer.request(*movie, index, movieGeneration, trackPanel->GetClientSize(),
+         false);
+   }
+   else {
+      // Keep showing the last frame until this one is ready; see onFramePrepared().
+      framePreparer.request(*movie, index, movieGeneration, trackPanel->GetClientSize());
+   }
+}
+
+void MainFrame::requestPyramid()
+{
+   // While another frame is being prepared, it asks for its pyramid when it's shown.
+   if (trackPanel->isZoomed() && shownIndex == displayedIndex) {
+      pyramidBuilder.request(*movie, shownIndex, movieGeneration);
+   }
+}
 
-      bitmap = std::make_shared<Bitmap>(nativeBitmap.GetWidth(), nativeBitmap.GetHeight());
+namespace {
+   // The budget is given in MiB by the FrameCacheSize key of track_hack.ini.  It defaults
+   // to FrameCache::defaultBudget(), or to an eighth of it if there is a compressed store
+   // holding most of the movie.
+   std::size_t frameCacheBudget()
+   {
+      long mebibytes = 0;
+      if (wxConfigBase::Get()->Read(u8"FrameCacheSize", &mebibytes) && mebibytes > 0) {
+         return std::size_t(mebibytes) << 20;
+      }
+      return compressedStoreBudget() ? FrameCache::defaultBudget() / 8 :
+                                       FrameCache::defaultBudget();
+   }
 
-      for (std::size_t row = 0; row < bitmap->height; ++row)
+   // The CompressedStoreSize key in MiB; 0 disables the store.  Defaults to the remaining
+   // seven eighths of FrameCache::defaultBudget().
+   std::size_t compressedStoreBudget()
+   {
+      long mebibytes = 0;
+      if (wxConfigBase::Get()->Read(u8"CompressedStoreSize", &mebibytes)) {
+         return mebibytes > 0 ? std::size_t(mebibytes) << 20 : 0;
+      }
+      return FrameCache::defaultBudget() / 8 * 7;
+   }
+
+   // The NativeBitmapCacheSize key limits the converted frames kept for display in MiB
+   // (128 by default).
+   std::size_t nativeBitmapBudget()
+   {
+      long mebibytes = 0;
+      if (!wxConfigBase::Get()->Read(u8"NativeBitmapCacheSize", &mebibytes) ||
+          mebibytes < 0)
       {
-         iterator.MoveTo(pixelData, 0, row);
-         for (std::size_t column = 0; column < bitmap->width; ++column)
-         {
-            (*bitmap)[row][column] = iterator.Red();
-            ++iterator;
-         }
+         mebibytes = 128;
       }
-      movie.getFrame(index).setBitmap(bitmap);
-   }*/
-   return nativeBitmap;
-}
+      return std::size_t(mebibytes) << 20;
+   }
+
+   // The LoaderThreads key; 0 (the default) means one thread per hardware thread.
+   unsigned loaderThreadCount()
+   {
+      long count = 0;
+      wxConfigBase::Get()->Read(u8"LoaderThreads", &count);
+      return count > 0 ? unsigned(count) : 0;
+   }
+
+   // The DiskCache key enables (the default) or disables the cache of decoded frames;
+   // DiskCacheSize limits it in MiB (4096 by default).
+   std::shared_ptr<DiskCache> makeDiskCache()
+   {
+      bool enabled = true;
+      wxConfigBase::Get()->Read(u8"DiskCache", &enabled);
+
+      long mebibytes = 0;
+      if (!wxConfigBase::Get()->Read(u8"DiskCacheSize", &mebibytes) || mebibytes <= 0) {
+         mebibytes = 4096;
+      }
+
+      const std::string dir = DiskCache::defaultDir();
+      if (!enabled || dir.empty()) {
+         return nullptr;
+      }
+      return std::make_shared<DiskCache>(dir, std::uint64_t(mebibytes) << 20);
+   }
+
+   // The BitmapPoolSize key limits the memory kept in free pixel buffers in MiB (256 by
+   // default); HugePages (on by default) requests huge pages for large ones.
+   void configureBitmapPool()
+   {
+      long mebibytes = 0;
+      if (wxConfigBase::Get()->Read(u8"BitmapPoolSize", &mebibytes) && mebibytes >= 0) {
+         BitmapPool::get().setLimit(std::size_t(mebibytes) << 20);
+      }
+
+      bool hugePages = true;
+      wxConfigBase::Get()->Read(u8"HugePages", &hugePages);
+      BitmapPool::get().setHugePages(hugePages);
+   }
+
+   // The IoUring key enables (the default) or disables reading frames through io_uring
+   // on Linux; IoThreads sets the number of threads reading them otherwise (8 by
+   // default).
+   void configureBatchReader()
+   {
+      bool ioUring = true;
+      wxConfigBase::Get()->Read(u8"IoUring", &ioUring);
+      BatchReader::get().setIoUring(ioUring);
+
+      long count = 0;
+      if (wxConfigBase::Get()->Read(u8"IoThreads", &count) && count > 0) {
+         BatchReader::get().setThreadCount(unsigned(count));
+      }
+   }
+
+   // The last values entered are kept under the RawWidth, RawHeight and RawOffset keys.
+   bool askRawFormat(wxWindow* parent, StreamSource::RawFormat& format)
+   {
+      wxConfigBase* config = wxConfigBase::Get();
+      const long width = wxGetNumberFromUser("Width of the frames in pixels:", "Width",
+         "Open a raw stream", config->ReadLong(u8"RawWidth", 640), 1, 1 << 16, parent);
+      if (width < 0) return false;
+      const long height = wxGetNumberFromUser("Height of the frames in pixels:", "Height",
+         "Open a raw stream", config->ReadLong(u8"RawHeight", 480), 1, 1 << 16, parent);
+      if (height < 0) return false;
+      const long offset = wxGetNumberFromUser("Size of the header before the first frame "
+         "in bytes:", "Offset", "Open a raw stream", config->ReadLong(u8"RawOffset", 0),
+         0, 1 << 30, parent);
+      if (offset < 0) return false;
+
+      config->Write(u8"RawWidth", width);
+      config->Write(u8"RawHeight", height);
+      config->Write(u8"RawOffset", offset);
+
+      format.width = std::size_t(width);
+      format.height = std::size_t(height);
+      format.offset = std::uint64_t(offset);
+      return true;
+   }
+
+   // The last values entered are kept under the PhaseWidth, PhaseHeight, PhaseOffset and
+   // PhaseSampleType keys.
+   bool askPhaseFormat(wxWindow* parent, PhaseSource::Format& format)
+   {
+      wxConfigBase* config = wxConfigBase::Get();
+      const long width = wxGetNumberFromUser("Width of the images in pixels:", "Width",
+         "Open phase images", config->ReadLong(u8"PhaseWidth", 1024), 1, 1 << 16, parent);
+      if (width < 0) return false;
+      const long height = wxGetNumberFromUser("Height of the images in pixels:", "Height",
+         "Open phase images", config->ReadLong(u8"PhaseHeight", 1024), 1, 1 << 16,
+         parent);
+      if (height < 0) return false;
+      const long offset = wxGetNumberFromUser("Size of the header before the samples in "
+         "bytes:", "Offset", "Open phase images", config->ReadLong(u8"PhaseOffset", 0),
+         0, 1 << 30, parent);
+      if (offset < 0) return false;
+
+      const wxString types[] = {"32-bit floating point", "16-bit unsigned integer",
+                                "16-bit signed integer"};
+      const int type = wxGetSingleChoiceIndex("Type of the samples:", "Open phase images",
+         3, types, parent, wxDefaultCoord, wxDefaultCoord, true, wxCHOICE_WIDTH,
+         wxCHOICE_HEIGHT, int(config->ReadLong(u8"PhaseSampleType", 0)));
+      if (type < 0) return false;
+
+      config->Write(u8"PhaseWidth", width);
+      config->Write(u8"PhaseHeight", height);
+      config->Write(u8"PhaseOffset", offset);
+      config->Write(u8"PhaseSampleType", type);
+
+      format.width = std::size_t(width);
+      format.height = std::size_t(height);
+      format.offset = std::uint64_t(offset);
+      format.type = type == 0 ? PhaseSource::SampleType::float32 :
+                    type == 1 ? PhaseSource::SampleType::uint16 :
+                                PhaseSource::SampleType::int16;
+      return true;
+   }
+
+   // The PhaseRangeLow and PhaseRangeHigh keys give the sample values shown as black and
+   // white.  Without them, the range of the samples of the movie is used.
+   PhaseSource::Range phaseRange()
+   {
+      double low = 0., high = 0.;
+      wxConfigBase::Get()->Read(u8"PhaseRangeLow", &low);
+      wxConfigBase::Get()->Read(u8"PhaseRangeHigh", &high);
+      return PhaseSource::Range{float(low), float(high)};
+   }
 
-namespace {
    wxString makeMarkString(std::size_t i)
    {
       std::stringstream sStream; sStream << i;
@@ -789,3 +1449,6 @@ namespace {
 }
 
 wxDEFINE_EVENT(myEVT_TRACKING_COMPLETED, wxThreadEvent);
+wxDEFINE_EVENT(myEVT_MOVIE_GROWN, wxThreadEvent);
+wxDEFINE_EVENT(myEVT_FRAME_PREPARED, wxThreadEvent);
+wxDEFINE_EVENT(myEVT_PYRAMID_BUILT, wxThreadEvent);
@@ -1,9 +1,10 @@
 #ifndef MAIN_FRAME_H
 #define MAIN_FRAME_H
 
-#include <cstddef> // size_t
+#include <cstddef>    // size_t
+#include <functional> // function
 #include <map>
-#include <memory>  // unique_ptr
+#include <memory>     // shared_ptr, unique_ptr
 #include <string>
 #include <vector>
 
@@ -17,7 +18,13 @@
 #include <wx/thread.h>  // wxThreadHelper
 #include <wx/timer.h>
 
+#include "directory_source.hpp"
+#include "disk_cache.hpp"
+#include "frame_preparer.hpp"
+#include "lru_cache.hpp"
 #include "movie.hpp"
+#include "prefetcher.hpp"
+#include "pyramid_builder.hpp"
 #include "track_panel.hpp"
 #include "trackee.hpp"
 #include "tracker.hpp"
@@ -25,6 +32,10 @@
 class TrackeeBox;
 
 wxDECLARE_EVENT(myEVT_TRACKING_COMPLETED, wxThreadEvent); // ...
+wxDECLARE_EVENT(myEVT_MOVIE_GROWN, wxThreadEvent); // a scanned directory or a stream
+                                                   // yielded frames
+wxDECLARE_EVENT(myEVT_FRAME_PREPARED, wxThreadEvent); // by the framePreparer
+wxDECLARE_EVENT(myEVT_PYRAMID_BUILT, wxThreadEvent);  // by the pyramidBuilder
 
 class MainFrame : public wxFrame, public wxThreadHelper
 {
@@ -39,9 +50,20 @@ class MainFrame : public wxFrame, public wxThreadHelper
    // Construct a platform-dependant wxBitmap for drawing it quickly and efficiently to a
    // device context from the bitmap (back end's representation) at the provided position.
    // I found wxBitmap to store at least RGB data on MSW and take no advantage of
-   // grayscale images.
+   // grayscale images.  Recently shown and prefetched frames are kept in nativeBitmaps.
    wxBitmap getBitmap(std::size_t);
 
+   // Empty nativeBitmaps and size it for the frames of the current movie.
+   void resetNativeBitmaps();
+
+   // Show a frame on the trackPanel and keep it pinned in the movie's frame cache; have
+   // the frames around it prefetched.  A frame that isn't decoded yet is shown once the
+   // framePreparer has it ready, unless another one was displayed in the meantime.
+   void displayFrame(std::size_t);
+
+   // Have the pyramid of the frame shown built if the trackPanel is zoomed in.
+   void requestPyramid();
+
    // handlers for events generated by trackeeBox and propagated upwards
    void onTrackeeBoxAdded(wxCommandEvent&);    // process a myEVT_COMMAND_TRACKEEBOX_ADDED
    void onTrackeeBoxSelected(wxCommandEvent&); // process a wxEVT_COMMAND_LISTBOX_SELECTED
@@ -52,6 +74,9 @@ class MainFrame : public wxFrame, public wxThreadHelper
 
    void onTrackPanelMarked(TrackPanelEvent&); // process a myEVT_TRACKPANEL_MARKED
    void onTrackPanelSave(wxCommandEvent&);    // process a myEVT_TRACKPANEL_Save
+   void onTrackPanelZoomed(wxCommandEvent&);  // process a myEVT_TRACKPANEL_ZOOMED
+   void onTrackPanelResized(wxCommandEvent&); // process a myEVT_TRACKPANEL_RESIZED
+   void onTrackPanelPicked(wxCommandEvent&);  // process a myEVT_TRACKPANEL_PICKED
 
    // handlers for events generated by movieSlider
    void onScrollThumbtrack(wxScrollEvent&); // process a wxEVT_SCROLL_THUMBTRACK event
@@ -63,6 +88,9 @@ class MainFrame : public wxFrame, public wxThreadHelper
 
    // Process wxEVT_COMMAND_MENU_SELECTED
    void onOpen(wxCommandEvent&);
+   void onOpenLive(wxCommandEvent&);
+   void onOpenFile(wxCommandEvent&);
+   void onPackMovie(wxCommandEvent&);
    void onSaveImage(wxCommandEvent&);
    void onTrack(wxCommandEvent&);
    void onDeleteTrackee(wxCommandEvent&);
@@ -73,11 +101,44 @@ class MainFrame : public wxFrame, public wxThreadHelper
    void onOneThroughThree(wxCommandEvent&); // process a wxEVT_COMMAND_MENU_SELECTED
 
    void onTrackingCompleted(wxThreadEvent&); // process a myEVT_TRACKING_COMPLETED
+   void onMovieGrown(wxThreadEvent&);        // process a myEVT_MOVIE_GROWN
+   void onFramePrepared(wxThreadEvent&);     // process a myEVT_FRAME_PREPARED
+   void onPyramidBuilt(wxThreadEvent&);      // process a myEVT_PYRAMID_BUILT
 
    void onClose(wxCloseEvent&); // process a wxEVT_CLOSE_WINDOW
 
    void onTimer(wxTimerEvent&);
 
+   // Convert a prefetched frame that was decoded in the meantime to a native bitmap;
+   // while there are none, convertTimer calls it again.
+   void onIdle(wxIdleEvent&);
+
+   // Ask for a directory and an expression and have the directory scanned; a live
+   // directory is watched for new frames after that.
+   void openDirectory(bool live);
+
+   // Replace the current movie and reset everything that refers to it; does nothing if
+   // the new movie has fewer than two frames.  A live movie is still being recorded.
+   void setMovie(std::unique_ptr<Movie>, bool live = false);
+
+   // A listener for growing sources that posts myEVT_MOVIE_GROWN events tagged with
+   // generation.
+   std::function<void(bool)> growthListener(unsigned long generation);
+
+   // Take in the frames found by the scan of the pending or current movie so far; the
+   // pending movie replaces the current one once it has two frames.  Deferred while
+   // tracking.  If the movie is live, the trackees that were tracked up to its old end
+   // are tracked on, and the newest frame is shown if the last one was.
+   void updateMovie();
+
+   // Have the new frames of trackees whose tracks were complete up to the old size
+   // tracked on the tracking thread.
+   void trackNewFrames(std::size_t oldSize);
+
+   // Start the tracking thread (see Entry()) and keep the trackees from being edited
+   // until it completes.  false if it couldn't be started.
+   bool startTracking();
+
    void addTrackee(std::string);
    void deleteTrackee(const std::string&);
    void saveImage();
@@ -100,12 +161,31 @@ class MainFrame : public wxFrame, public wxThreadHelper
    wxSlider* movieSlider;
 
    wxTimer panelUpdateTimer;
+   wxTimer convertTimer; // wakes onIdle() up while prefetched frames are being decoded
 
    // a map of vectors holding all the marks provided for a particular trackee
    std::map<std::string, std::vector<std::size_t>> marks;
 
+   std::shared_ptr<DiskCache> diskCache; // nullptr if disabled
    std::unique_ptr<Movie> movie;
+   std::unique_ptr<Movie> pendingMovie; // being scanned; not shown yet
+   bool live, pendingLive; // whether movie and pendingMovie are being recorded
+   const DirectorySource* scanningSource; // of movie or pendingMovie; nullptr when done
+   unsigned long scanGeneration;          // tells events of abandoned scans apart
+   unsigned long scanGenerations;         // handed to growth listeners so far; a scan
+                                          // only becomes current once its movie is
+                                          // accepted or pending
+   std::size_t displayedIndex; // pinned in the frame cache of movie
+   std::size_t shownIndex;     // on the trackPanel; lags displayedIndex while preparing
+   LruCache<std::size_t, wxBitmap> nativeBitmaps; // of movie, by index
+   std::vector<std::size_t> toConvert; // prefetched frames to add to nativeBitmaps
+   unsigned convertPolls; // of convertTimer since a frame was last converted
+   FramePreparer framePreparer; // declared after movie, so it stops before movie goes
+   PyramidBuilder pyramidBuilder; // ditto
+   unsigned long movieGeneration; // tells frames prepared for replaced movies apart
+   Prefetcher prefetcher;
    Tracker tracker;
+   std::size_t trackFrom; // the first new frame tracked on; 0 if whole tracks are tracked
    std::map<std::string, Trackee> trackees;
 };
 
@@ -0,0 +1,30 @@
+#include <stdexcept> // invalid_argument
+
+#define BOOST_FILESYSTEM_NO_DEPRECATED // Exclude deprecated features from headers.
+#include <boost/filesystem.hpp>
+
+#include "memory_source.hpp"
+
+MemorySource::MemorySource(const std::string& dir,
+   std::vector<std::shared_ptr<const Bitmap>> frames, std::vector<std::string> names) :
+   dir{dir}, frames{std::move(frames)}, names{std::move(names)}
+{
+   using boost::filesystem::path;
+
+   // Append a directory separator if necessary, so concatenation works as expected.
+   if (this->dir.empty() || this->dir.back() != path::preferred_separator) {
+      this->dir += path::preferred_separator;
+   }
+
+   if (this->names.size() != this->frames.size()) {
+      throw std::invalid_argument{"Every frame needs a name."};
+   }
+   for (const auto& frame : this->frames)
+   {
+      if (!frame || frame->width != this->frames.front()->width ||
+          frame->height != this->frames.front()->height)
+      {
+         throw std::invalid_argument{"The frames have to be of the same size."};
+      }
+   }
+}
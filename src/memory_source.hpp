@@ -0,0 +1,51 @@
+#ifndef MEMORY_SOURCE_H
+#define MEMORY_SOURCE_H
+
+#include <cstddef> // size_t
+#include <memory>  // shared_ptr
+#include <string>
+#include <vector>
+
+#include "frame_source.hpp"
+
+// Frames that are already in memory, e.g. rendered by the program itself.  load() hands
+// out the frames as they are, without copying.
+class MemorySource : public FrameSource
+{
+   public:
+
+   // There has to be a name for every frame.  Throws std::invalid_argument if there isn't
+   // or the frames differ in size.
+   MemorySource(const std::string& directory,
+                std::vector<std::shared_ptr<const Bitmap>> frames,
+                std::vector<std::string> names);
+
+   virtual std::string getDir() const override;
+   virtual std::size_t size() const override;
+   virtual std::string getName(std::size_t) const override;
+   virtual std::shared_ptr<const Bitmap> load(std::size_t) const override;
+
+   private:
+
+   std::string dir;
+   std::vector<std::shared_ptr<const Bitmap>> frames;
+   std::vector<std::string> names;
+};
+
+inline std::string MemorySource::getDir() const {
+   return dir;
+}
+
+inline std::size_t MemorySource::size() const {
+   return frames.size();
+}
+
+inline std::string MemorySource::getName(std::size_t i) const {
+   return names[i];
+}
+
+inline std::shared_ptr<const Bitmap> MemorySource::load(std::size_t i) const {
+   return frames[i];
+}
+
+#endif //MEMORY_SOURCE_H
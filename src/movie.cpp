@@ -1,88 +1,161 @@
-#include <algorithm>
-
-#define BOOST_FILESYSTEM_NO_DEPRECATED // Exclude deprecated features from headers.
-#include <boost/filesystem.hpp>
+#include <algorithm> // max, min
 
+#include "directory_source.hpp"
 #include "movie.hpp"
 
-Movie::Movie(const std::string& dir, const std::string& regExString) :
-   dir{new std::string{dir}}, frames{}, bitmapBuffer{}, terminateThread{false}
+Movie::Movie(const std::string& dir, const std::string& regEx, std::size_t cacheBudget,
+   unsigned loaderThreads, std::size_t storeBudget) :
+   Movie{std::unique_ptr<FrameSource>{new DirectorySource{dir, regEx}}, cacheBudget,
+         loaderThreads, storeBudget} {}
+
+Movie::Movie(std::unique_ptr<FrameSource> frameSource, std::size_t cacheBudget,
+   unsigned loaderThreads, std::size_t storeBudget) :
+   source{std::move(frameSource)}, dir{source->getDir()}, frameCount{source->size()},
+   populated{0}, cache{cacheBudget, frameCount},
+   store{storeBudget ? new CompressedStore{storeBudget, frameCount} : nullptr},
+   loader{cache, [this](std::size_t i) { return decode(i); }, loaderThreads,
+          [this](const std::vector<std::size_t>& indices, const FrameLoader::Sink& sink) {
+             decode(indices, sink);
+          },
+          [this](std::size_t i, std::size_t first, std::size_t last) {
+             return decodeRows(i, first, last);
+          }}
 {
-   using namespace boost::filesystem;
+   populateBuffer();
+}
 
-   // Append a directory separator if necessary, so concatenation works as expected.
-   if (*--this->dir->end() != path::preferred_separator) {
-      *this->dir += path::preferred_separator;
+// Queued decodes are dropped and the loader's threads joined when the loader is
+// destroyed; nothing else to do.
+Movie::~Movie() = default;
+
+std::shared_ptr<const Bitmap> Movie::getBitmap(std::size_t i, bool load) const
+{
+   return load ? loader.load(i) : cache.get(i);
+}
+
+std::shared_ptr<const Bitmap> Movie::getRows(std::size_t i, std::size_t first,
+   std::size_t last) const
+{
+   return loader.loadRows(i, first, last);
+}
+
+std::size_t Movie::update(std::vector<std::size_t>* rewritten)
+{
+   for (std::size_t i : source->takeRewritten())
+   {
+      if (i >= frameCount) continue; // not taken in yet, so not decoded either
+      cache.drop(i);
+      if (store) store->drop(i);
+      loader.request(i);
+      if (rewritten) rewritten->push_back(i);
    }
 
-   try
+   const std::size_t oldSize = frameCount, newSize = source->size();
+   if (newSize > oldSize)
    {
-      path path{*this->dir};
-      if (exists(path) && is_directory(path))
-      {
-         boost::regex regEx{regExString, boost::regex::perl};
-         boost::cmatch matches;
-         for (directory_iterator i{path}; i != directory_iterator{}; ++i)
-         {
-            if (is_regular_file(i->status()) &&
-               boost::regex_search(i->path().filename().generic_string().c_str(),
-               matches, regEx))
-            {
-               frames.push_back(std::move(Frame{this->dir, i->path().filename()}));
-            }
-         }
-         // On my Windows system, directory iteration was ordered, on my GNU/Linux system,
-         // it's not: make sure frames are sorted on systems other than Windows, too.
-         // _WIN32 is defined for both 32-bit and 64-bit environments.
-         #ifndef _WIN32
-           std::sort(frames.begin(), frames.end());
-         #endif
-      }
+      cache.resize(newSize);
+      if (store) store->resize(newSize);
+      frameCount = newSize;
    }
-   catch (const filesystem_error&) {
-      throw;
+   if (populated < frameCount) {
+      populateBuffer();
    }
+   return frameCount;
+}
+
+// All frames of a movie have the same size, so the first one tells how much room each
+// needs.  It is decoded right away since it will most likely be shown first.
+void Movie::populateBuffer()
+{
+   if (!size()) return;
+
+   auto bitmap = loader.load(0);
+   if (!bitmap) return;
 
-   //// <_..._> ////
-   ///
+   const std::size_t first = std::max<std::size_t>(populated, 1);
+   populated = size();
 
-   try {
-      thread = boost::thread{&Movie::populateBuffer, this};
-   } catch (...) {
-      // ...
+   if (store)
+   {
+      // Keyframes first, so the frames in between can be coded relative to them.
+      const std::size_t interval = store->getKeyframeInterval();
+      for (std::size_t i = (first + interval - 1) / interval * interval; i < size();
+           i += interval)
+      {
+         loader.request(i);
+      }
+      for (std::size_t i = first; i < size(); ++i) {
+         if (i % interval) loader.request(i);
+      }
+      return;
    }
 
-   ///
-   //// </_..._> ////
+   const std::size_t frameBytes = sizeof(Bitmap) + bitmap->width * bitmap->height;
+   const std::size_t fitting = std::min(size(), cache.getStats().budget / frameBytes);
+
+   for (std::size_t i = first; i < fitting; ++i) {
+      loader.request(i);
+   }
 }
 
-Movie::~Movie()
+std::shared_ptr<const Bitmap> Movie::decode(std::size_t i) const
 {
-   {
-      boost::lock_guard<boost::mutex> lock{terminateFlagAccess};
-      terminateThread = true;
+   if (!store) {
+      return source->load(i);
+   }
+   if (auto bitmap = store->get(i)) {
+      return bitmap;
    }
-   thread.join();
+
+   auto bitmap = source->load(i);
+   addToStore(i, bitmap);
+   return bitmap;
 }
 
-Movie& Movie::operator=(Movie&& movee)
+// Frames in the store don't need to be read.
+void Movie::decode(const std::vector<std::size_t>& indices,
+   const FrameLoader::Sink& sink) const
 {
-   dir =          std::move(movee.dir);
-   frames =       std::move(movee.frames);
-   bitmapBuffer = std::move(movee.bitmapBuffer);
+   if (!store) {
+      source->loadBatch(indices, sink);
+      return;
+   }
 
-   return *this;
+   std::vector<std::size_t> toLoad;
+   for (std::size_t i : indices)
+   {
+      if (auto bitmap = store->get(i)) {
+         sink(i, std::move(bitmap));
+      }
+      else {
+         toLoad.push_back(i);
+      }
+   }
+
+   source->loadBatch(toLoad, [this, &sink](std::size_t i,
+                                           std::shared_ptr<const Bitmap> bitmap) {
+         addToStore(i, bitmap);
+         sink(i, std::move(bitmap));
+      }
+   );
 }
 
-void Movie::populateBuffer()
+// A frame in the store is decoded from memory, which beats reading even a band of it.
+std::shared_ptr<const Bitmap> Movie::decodeRows(std::size_t i, std::size_t first,
+   std::size_t last) const
 {
-   for (std::size_t i = 0; i < size() && bitmapBuffer.size() < 1024; ++i)
+   if (store)
    {
-      bitmapBuffer.push_front(frames[i].getBitmap());
-      frames[i].setBitmap(bitmapBuffer.front());
-      {
-         boost::lock_guard<boost::mutex> lock{terminateFlagAccess};
-         if (terminateThread) break;
-      }
+      if (auto bitmap = store->get(i)) return bitmap;
+   }
+   return source->loadRows(i, first, last);
+}
+
+void Movie::addToStore(std::size_t i,
+   const std::shared_ptr<const Bitmap>& bitmap) const
+{
+   if (bitmap && store && !store->insert(i, *bitmap) && store->isFull()) {
+      // The rest of the movie won't fit either; stop filling the store.
+      loader.cancel(FrameLoader::Priority::low);
    }
 }
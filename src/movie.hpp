@@ -1,72 +1,175 @@
 #ifndef MOVIE_H
 #define MOVIE_H
 
+#include <atomic>
 #include <cstddef> // size_t
-#include <deque>
-#include <memory>  // shared_ptr
+#include <memory>  // shared_ptr, unique_ptr
 #include <string>
 #include <vector>
 
-#include <boost/regex.hpp> // Note: switch to <regex> from the stdlib when upgrading to a
-                           // future release of GCC.
-
-#define BOOST_THREAD_USE_LIB
-#include <boost/thread.hpp> // thread
-
-#include "frame.hpp"
+#include "compressed_store.hpp"
+#include "frame_cache.hpp"
+#include "frame_loader.hpp"
+#include "frame_source.hpp"
 
 class Movie
 {
    public:
 
-   Movie() = default;
+   Movie() = delete;
    Movie(const Movie&) = delete;
-   Movie(Movie&&);
-   Movie(const std::string& directory, const std::string& regEx);
+   Movie(Movie&&) = delete; // the loader's threads refer to this object
+
+   // Load the image files in directory whose names match regEx.  A loaderThreads argument
+   // of 0 uses one loader thread per hardware thread.  If storeBudget isn't 0, decoded
+   // frames are also kept in a CompressedStore of that size, and the loader threads fill
+   // it with the whole movie (or as much as fits) in the background; the frame cache then
+   // only needs to hold the frames in use.
+   Movie(const std::string& directory, const std::string& regEx,
+         std::size_t cacheBudget = FrameCache::defaultBudget(),
+         unsigned loaderThreads = 0, std::size_t storeBudget = 0);
+
+   Movie(std::unique_ptr<FrameSource>,
+         std::size_t cacheBudget = FrameCache::defaultBudget(),
+         unsigned loaderThreads = 0, std::size_t storeBudget = 0);
 
    ~Movie();
 
    Movie& operator=(const Movie&) = delete;
-   Movie& operator=(Movie&&);
+   Movie& operator=(Movie&&) = delete;
+
+   // Take in the frames the source published since the movie was constructed or this was
+   // last called (see DirectorySource), and return the new size.  Until then, the movie
+   // keeps its size even if its source grows.  Frames the source rewrote meanwhile are
+   // dropped from the caches and decoded again; their indices are added to rewritten if
+   // it is given.
+   std::size_t update(std::vector<std::size_t>* rewritten = nullptr);
 
    const std::string& getDir() const;
-   const Frame& getFrame(std::size_t) const;
+   std::string getName(std::size_t) const;     // e.g. the file name of the frame
    std::string getFilename(std::size_t) const; // includes directory
    std::size_t getSize() const;
    std::size_t size() const;
 
+   // Look the bitmap up in the frame cache; if it isn't cached and load is true, decode
+   // it (or wait for a loader thread that is already decoding it) and try to cache it.
+   // nullptr if the bitmap wasn't cached and load is false, or if it couldn't be decoded
+   // (e.g. a file that is still being written).  Thread-safe.
+   std::shared_ptr<const Bitmap> getBitmap(std::size_t, bool load = true) const;
+
+   // Return the cached frame if there is one, or the rows asked for by requestRows() if
+   // they include rows first to last (exclusive).  Otherwise, decode at least those rows
+   // without caching them: from the compressed store if it holds the frame, or through
+   // the source, which may return just a band of them (see Bitmap).  nullptr if they
+   // couldn't be decoded.  Thread-safe.
+   std::shared_ptr<const Bitmap> getRows(std::size_t, std::size_t first,
+                                         std::size_t last) const;
+
+   // Have a loader thread decode the rows for getRows() ahead of any frame.
+   void requestRows(std::size_t, std::size_t first, std::size_t last) const;
+
+   // true if getRows() is cheaper than getBitmap() for small bands of rows
+   bool hasRowAccess() const;
+
+   // The height of the frames if the source can tell it without decoding one; 0
+   // otherwise.
+   std::size_t getFrameHeight() const;
+
+   // Have a loader thread decode the frame unless it's cached or being decoded.
+   void request(std::size_t,
+                FrameLoader::Priority = FrameLoader::Priority::low) const;
+
+   // Have loader threads decode these frames in the given order, replacing the frames
+   // of any earlier call that haven't been started yet.
+   void prefetch(const std::vector<std::size_t>&) const;
+
+   // Pinned frames stay in the cache (once loaded) until they are unpinned.
+   void pin(std::size_t) const;
+   void unpin(std::size_t) const;
+
+   FrameCache::Stats getCacheStats() const;
+   CompressedStore::Stats getStoreStats() const; // all zero if there is no store
+
    private:
 
+   // Have the loader decode as many of the frames not populated yet (in order) as fit
+   // into the cache, or all of them if there is a compressed store.  Nothing is queued
+   // while the first frame can't be decoded; the next call tries again.
    void populateBuffer();
 
-   std::string* dir;
-   std::vector<Frame> frames;
+   // run by the loader threads
+   std::shared_ptr<const Bitmap> decode(std::size_t) const;
+   void decode(const std::vector<std::size_t>&, const FrameLoader::Sink&) const;
+   std::shared_ptr<const Bitmap> decodeRows(std::size_t, std::size_t first,
+                                            std::size_t last) const;
+
+   // Add a frame decoded from the source to the store, if there is one.
+   void addToStore(std::size_t, const std::shared_ptr<const Bitmap>&) const;
 
-   std::deque<std::shared_ptr<const Bitmap>> bitmapBuffer;
+   std::unique_ptr<FrameSource> source;
+   std::string dir;
+   std::atomic<std::size_t> frameCount; // source->size() as of the last update()
+   std::size_t populated; // frames populateBuffer() has been through
 
-   bool terminateThread;
-   boost::mutex terminateFlagAccess;
-   boost::thread thread;
+   mutable FrameCache cache;
+   std::unique_ptr<CompressedStore> store; // nullptr if disabled
+   mutable FrameLoader loader; // declared last: its threads are joined first
 };
 
 inline const std::string& Movie::getDir() const {
-   return *dir;
+   return dir;
 }
 
-inline const Frame& Movie::getFrame(std::size_t i) const {
-   return frames[i];
+inline std::string Movie::getName(std::size_t i) const {
+   return source->getName(i);
 }
 
 inline std::string Movie::getFilename(std::size_t i) const {
-   return *dir + frames[i].getFilename();
+   return dir + source->getName(i);
 }
 
 inline std::size_t Movie::getSize() const {
-   return frames.size();
+   return frameCount;
 }
 
 inline std::size_t Movie::size() const {
-   return frames.size();
+   return frameCount;
+}
+
+inline void Movie::requestRows(std::size_t i, std::size_t first, std::size_t last) const {
+   loader.requestRows(i, first, last);
+}
+
+inline bool Movie::hasRowAccess() const {
+   return source->hasRowAccess();
+}
+
+inline std::size_t Movie::getFrameHeight() const {
+   return source->getFrameHeight();
+}
+
+inline void Movie::request(std::size_t i, FrameLoader::Priority priority) const {
+   loader.request(i, priority);
+}
+
+inline void Movie::prefetch(const std::vector<std::size_t>& indices) const {
+   loader.prefetch(indices);
+}
+
+inline void Movie::pin(std::size_t i) const {
+   cache.pin(i);
+}
+
+inline void Movie::unpin(std::size_t i) const {
+   cache.unpin(i);
+}
+
+inline FrameCache::Stats Movie::getCacheStats() const {
+   return cache.getStats();
+}
+
+inline CompressedStore::Stats Movie::getStoreStats() const {
+   return store ? store->getStats() : CompressedStore::Stats{0, 0, 0, 0};
 }
 
 #endif //MOVIE_H
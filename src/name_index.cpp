@@ -0,0 +1,120 @@
+#include <limits>
+#include <stdexcept> // length_error
+
+#include "name_index.hpp"
+
+namespace {
+   const std::size_t maxDigits = 9; // so every number fits in 32 bits
+
+   bool isDigit(char c) {
+      return c >= '0' && c <= '9';
+   }
+}
+
+NameIndex::NameIndex() : templated{true}, prefix{}, suffix{}, digits{0}, numbers{},
+   arena{}, offsets{} {}
+
+void NameIndex::push_back(const std::string& name)
+{
+   if (templated && numbers.empty())
+   {
+      // The template is taken from the first name: its last run of digits is the number.
+      std::size_t end = name.size();
+      while (end && !isDigit(name[end - 1])) --end;
+      std::size_t first = end;
+      while (first && isDigit(name[first - 1])) --first;
+
+      if (first != end && end - first <= maxDigits)
+      {
+         prefix = name.substr(0, first);
+         suffix = name.substr(end);
+         digits = name[first] == '0' ? unsigned(end - first) : 1;
+      }
+      else {
+         templated = false;
+      }
+   }
+
+   std::uint32_t number;
+   if (templated)
+   {
+      if (fits(name, number)) {
+         numbers.push_back(number);
+         return;
+      }
+      dropTemplate();
+   }
+
+   append(name);
+}
+
+void NameIndex::reserve(std::size_t count)
+{
+   if (templated) {
+      numbers.reserve(count);
+   }
+   else {
+      offsets.reserve(count);
+   }
+}
+
+std::string NameIndex::operator[](std::size_t i) const
+{
+   if (templated) {
+      return format(numbers[i]);
+   }
+   const std::size_t end = i + 1 < offsets.size() ? offsets[i + 1] : arena.size();
+   return arena.substr(offsets[i], end - offsets[i]);
+}
+
+bool NameIndex::fits(const std::string& name, std::uint32_t& number) const
+{
+   if (name.size() <= prefix.size() + suffix.size() ||
+       name.compare(0, prefix.size(), prefix) ||
+       name.compare(name.size() - suffix.size(), suffix.size(), suffix))
+   {
+      return false;
+   }
+
+   const std::size_t first = prefix.size(), end = name.size() - suffix.size();
+   if (end - first > maxDigits) {
+      return false;
+   }
+   number = 0;
+   for (std::size_t i = first; i < end; ++i)
+   {
+      if (!isDigit(name[i])) return false;
+      number = 10 * number + std::uint32_t(name[i] - '0');
+   }
+
+   // The name has to come out the same again, e.g. not "frame_7.bmp" if the numbers are
+   // padded to 4 digits.
+   const std::size_t length = end - first;
+   return length == digits || (length > digits && name[first] != '0');
+}
+
+std::string NameIndex::format(std::uint32_t number) const
+{
+   std::string numeral = std::to_string(number);
+   if (numeral.size() < digits) numeral.insert(0, digits - numeral.size(), '0');
+   return prefix + numeral + suffix;
+}
+
+void NameIndex::dropTemplate()
+{
+   offsets.reserve(numbers.capacity());
+   for (std::uint32_t number : numbers) {
+      append(format(number));
+   }
+   templated = false;
+   numbers = std::vector<std::uint32_t>{};
+}
+
+void NameIndex::append(const std::string& name)
+{
+   if (arena.size() + name.size() > std::numeric_limits<std::uint32_t>::max()) {
+      throw std::length_error{"too many frame names"};
+   }
+   offsets.push_back(std::uint32_t(arena.size()));
+   arena += name;
+}
@@ -0,0 +1,65 @@
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t
+#include <string>
+#include <vector>
+
+// The file names of a movie's frames, stored compactly enough for millions of frames.  As
+// long as the names follow a template (a prefix, a number of up to 9 digits and a suffix,
+// e.g. "frame_000042.bmp"), only the numbers are kept, 4 bytes per name.  Once a name
+// doesn't fit, all names are kept back to back in one string and found by 32-bit
+// offsets, taking 4 bytes plus the name's length.
+class NameIndex
+{
+   public:
+
+   NameIndex();
+
+   // Throws std::length_error if the names would take more than 4 GiB.
+   void push_back(const std::string&);
+
+   void reserve(std::size_t);
+
+   std::string operator[](std::size_t) const;
+   std::size_t size() const;
+   bool empty() const;
+
+   // true as long as the names follow a template
+   bool isTemplated() const;
+
+   private:
+
+   // Set number if name follows the template.
+   bool fits(const std::string& name, std::uint32_t& number) const;
+
+   std::string format(std::uint32_t number) const;
+
+   // Move the names to the arena.
+   void dropTemplate();
+
+   void append(const std::string&); // to the arena
+
+   bool templated;
+   std::string prefix, suffix;
+   unsigned digits; // the numbers are padded with zeros to at least this many
+   std::vector<std::uint32_t> numbers;
+
+   std::string arena;
+   std::vector<std::uint32_t> offsets; // where each name starts in arena
+};
+
+inline std::size_t NameIndex::size() const {
+   return templated ? numbers.size() : offsets.size();
+}
+
+inline bool NameIndex::empty() const {
+   return !size();
+}
+
+inline bool NameIndex::isTemplated() const {
+   return templated;
+}
+
+#endif //NAME_INDEX_H
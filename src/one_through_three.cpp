@@ -166,10 +166,15 @@ void OneThroughThreeDialog::apply()
 
       for (std::size_t i = 0; i < movie->getSize(); ++i)
       {
-         oStream << movie->getFrame(i).getFilename();
+         oStream << movie->getName(i);
          if ((*track)[i] != Point{-1, -1})
          {
-            std::shared_ptr<const Bitmap> bitmap = movie->getFrame(i).getBitmap();
+            std::shared_ptr<const Bitmap> bitmap = movie->getBitmap(i);
+            if (!bitmap) {
+               // The frame couldn't be decoded; leave its values out.
+               oStream << std::endl;
+               continue;
+            }
 
             // gray level
             oStream << '\t' << static_cast<int>((*bitmap)[(*track)[i].y][(*track)[i].x]);
@@ -179,7 +184,7 @@ void OneThroughThreeDialog::apply()
 
             // ...
             {
-               std::string logFile = movie->getDir() + movie->getFrame(i).getFilename();
+               std::string logFile = movie->getDir() + movie->getName(i);
                std::size_t pos = logFile.find("_uw.bmp");
                if (pos != std::string::npos)
                {
@@ -0,0 +1,66 @@
+#include <cstring> // memcpy, memset
+
+#include "pack_bits.hpp"
+
+std::vector<Byte> packBits(const Byte* data, std::size_t size)
+{
+   std::vector<Byte> encoded;
+   encoded.reserve(size / 2);
+
+   std::size_t i = 0;
+   while (i < size)
+   {
+      // Measure the run starting at i.
+      std::size_t run = 1;
+      while (i + run < size && run < 128 && data[i + run] == data[i]) ++run;
+
+      if (run > 1)
+      {
+         encoded.push_back(Byte(257 - run));
+         encoded.push_back(data[i]);
+         i += run;
+      }
+      else
+      {
+         // Collect literals until a run of at least three bytes starts; shorter runs
+         // aren't worth breaking the literal sequence for.
+         std::size_t count = 1;
+         while (i + count < size && count < 128 &&
+                !(i + count + 2 < size && data[i + count] == data[i + count + 1] &&
+                  data[i + count] == data[i + count + 2])) {
+            ++count;
+         }
+         encoded.push_back(Byte(count - 1));
+         encoded.insert(encoded.end(), data + i, data + i + count);
+         i += count;
+      }
+   }
+
+   return encoded;
+}
+
+bool unpackBits(const Byte* encoded, std::size_t encodedSize, Byte* data,
+   std::size_t size)
+{
+   std::size_t in = 0, out = 0;
+   while (in < encodedSize)
+   {
+      const Byte control = encoded[in++];
+      if (control < 128)
+      {
+         const std::size_t count = control + 1;
+         if (in + count > encodedSize || out + count > size) return false;
+         std::memcpy(data + out, encoded + in, count);
+         in += count; out += count;
+      }
+      else if (control > 128)
+      {
+         const std::size_t count = 257 - control;
+         if (in >= encodedSize || out + count > size) return false;
+         std::memset(data + out, encoded[in++], count);
+         out += count;
+      }
+      // 128 is a no-op.
+   }
+   return out == size;
+}
@@ -0,0 +1,19 @@
+#ifndef PACK_BITS_H
+#define PACK_BITS_H
+
+#include <cstddef> // size_t
+#include <vector>
+
+#include "bitmap.hpp" // Byte
+
+// PackBits run-length encoding as used by TIFF and MacPaint: a control byte n of 0 to 127
+// is followed by n + 1 literal bytes; 129 to 255 by one byte that's repeated 257 - n
+// times.  It is cheap enough to decode at memory bandwidth.
+
+std::vector<Byte> packBits(const Byte* data, std::size_t size);
+
+// Return false if the encoded data is malformed or doesn't decode to exactly size bytes.
+bool unpackBits(const Byte* encoded, std::size_t encodedSize, Byte* data,
+   std::size_t size);
+
+#endif //PACK_BITS_H
@@ -0,0 +1,247 @@
+#include <cstdio>    // remove
+#include <cstring>   // memcmp, memcpy
+#include <fstream>   // ofstream
+#include <stdexcept> // runtime_error
+#include <utility>   // move
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/predef/other/endian.h>
+
+#define BOOST_FILESYSTEM_NO_DEPRECATED // Exclude deprecated features from headers.
+#include <boost/filesystem.hpp>
+
+#include "movie.hpp"
+#include "pack_bits.hpp"
+#include "packed_movie.hpp"
+#include "read_ahead.hpp"
+
+#if !BOOST_ENDIAN_LITTLE_BYTE
+  #error
+#endif
+
+static_assert(sizeof(PackedSource::Header) == 56, "unexpected padding");
+static_assert(sizeof(PackedSource::IndexEntry) == 32, "unexpected padding");
+
+namespace {
+   const char magic[8] = {'T', 'H', 'M', 'O', 'V', 'I', 'E', '\0'};
+
+   // Removes a file when it goes, unless it was kept.
+   struct TemporaryFile
+   {
+      explicit TemporaryFile(std::string name) : name{std::move(name)}, kept{false} {}
+      ~TemporaryFile() { if (!kept) std::remove(name.c_str()); }
+
+      std::string name;
+      bool kept;
+   };
+}
+
+constexpr std::uint32_t PackedSource::version;
+constexpr std::uint32_t PackedSource::alignment;
+constexpr std::uint32_t PackedSource::uncompressed;
+constexpr std::uint32_t PackedSource::packBitsCompressed;
+
+PackedSource::PackedSource(const std::string& fileName)
+{
+   using namespace boost::interprocess;
+
+   try {
+      file_mapping mapping{fileName.c_str(), read_only};
+      region = std::make_shared<mapped_region>(mapping, read_only);
+   }
+   catch (const interprocess_exception& exception) {
+      throw std::runtime_error{"Can't map " + fileName + ": " + exception.what()};
+   }
+
+   data = static_cast<const Byte*>(region->get_address());
+   fileSize = region->get_size();
+
+   if (fileSize < sizeof(Header)) {
+      throw std::runtime_error{fileName + " is not a packed movie."};
+   }
+   std::memcpy(&header, data, sizeof(Header));
+
+   if (std::memcmp(header.magic, magic, sizeof(magic)) || header.version != version) {
+      throw std::runtime_error{fileName + " is not a packed movie of this version."};
+   }
+   if (header.indexOffset > fileSize ||
+       header.frameCount > (fileSize - header.indexOffset) / sizeof(IndexEntry) ||
+       header.namesOffset > fileSize || header.namesSize > fileSize - header.namesOffset)
+   {
+      throw std::runtime_error{fileName + " is truncated or corrupt."};
+   }
+
+   dir = boost::filesystem::absolute(fileName).parent_path().make_preferred().string();
+   if (dir.empty() || dir.back() != boost::filesystem::path::preferred_separator) {
+      dir += boost::filesystem::path::preferred_separator;
+   }
+}
+
+std::string PackedSource::getName(std::size_t i) const
+{
+   const IndexEntry entry = getEntry(i);
+   if (std::uint64_t{entry.nameOffset} + entry.nameSize > header.namesSize) {
+      return std::string{};
+   }
+   return std::string{reinterpret_cast<const char*>(data + header.namesOffset +
+      entry.nameOffset), entry.nameSize};
+}
+
+std::shared_ptr<const Bitmap> PackedSource::load(std::size_t i) const
+{
+   const IndexEntry entry = getEntry(i);
+   const std::size_t frameSize = std::size_t{header.width} * header.height;
+
+   if (entry.offset > fileSize || entry.size > fileSize - entry.offset) {
+      throw std::runtime_error{"frame " + std::to_string(i) + " is truncated"};
+   }
+
+   if (entry.compression == uncompressed && entry.size == frameSize)
+   {
+      // Bitmap takes a non-const pointer but the frame is only ever handed out as const.
+      return std::make_shared<Bitmap>(header.width, header.height,
+         const_cast<Byte*>(data + entry.offset), region);
+   }
+   else if (entry.compression == packBitsCompressed)
+   {
+      auto bitmap = std::make_shared<Bitmap>(header.width, header.height);
+      if (unpackBits(data + entry.offset, entry.size, bitmap->pixels, frameSize)) {
+         return bitmap;
+      }
+   }
+   throw std::runtime_error{"frame " + std::to_string(i) + " is corrupt"};
+}
+
+PackedSource::IndexEntry PackedSource::getEntry(std::size_t i) const
+{
+   IndexEntry entry;
+   std::memcpy(&entry, data + header.indexOffset + i * sizeof(IndexEntry),
+      sizeof(IndexEntry));
+   return entry;
+}
+
+bool packMovie(const Movie& movie, const std::string& fileName, bool compress,
+   const std::function<bool(std::size_t)>& progress)
+{
+   typedef PackedSource::Header     Header;
+   typedef PackedSource::IndexEntry IndexEntry;
+
+   // declared before the stream, so the file is closed before it's removed
+   TemporaryFile temporary{fileName + ".part"};
+   std::ofstream oStream{temporary.name, std::ios::binary};
+   if (!oStream) {
+      throw std::runtime_error{"Can't open " + temporary.name + " for writing."};
+   }
+
+   Header header{};
+   std::memcpy(header.magic, magic, sizeof(magic));
+   header.version = PackedSource::version;
+   header.alignment = PackedSource::alignment;
+   header.frameCount = movie.getSize();
+
+   std::vector<IndexEntry> index;
+   index.reserve(movie.getSize());
+   std::string names;
+
+   // Pad the file with zeros up to the next multiple of the alignment.
+   const std::vector<char> zeros(PackedSource::alignment);
+   std::uint64_t offset = 0;
+   auto align = [&]() {
+      std::uint64_t padding = -offset % PackedSource::alignment;
+      oStream.write(zeros.data(), padding);
+      offset += padding;
+   };
+
+   oStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+   offset += sizeof(header);
+
+   std::vector<std::size_t> order(movie.getSize());
+   for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+   ReadAhead readAhead{movie, std::move(order)};
+
+   bool cancelled = false;
+   for (std::size_t i = 0; i < movie.getSize() && !cancelled; ++i)
+   {
+      auto bitmap = readAhead.next(i);
+      if (!bitmap) {
+         throw std::runtime_error{"Can't read " + movie.getFilename(i) + "."};
+      }
+      if (i == 0) {
+         header.width  = bitmap->width;
+         header.height = bitmap->height;
+      }
+      else if (bitmap->width != header.width || bitmap->height != header.height) {
+         throw std::runtime_error{movie.getFilename(i) + " differs in size from the "
+            "first frame."};
+      }
+
+      const std::size_t frameSize = bitmap->width * bitmap->height;
+
+      IndexEntry entry{};
+      std::vector<Byte> encoded;
+      if (compress) {
+         encoded = packBits(bitmap->pixels, frameSize);
+      }
+
+      align();
+      entry.offset = offset;
+      if (compress && encoded.size() < frameSize)
+      {
+         entry.compression = PackedSource::packBitsCompressed;
+         entry.size = encoded.size();
+         oStream.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+      }
+      else
+      {
+         entry.compression = PackedSource::uncompressed;
+         entry.size = frameSize;
+         oStream.write(reinterpret_cast<const char*>(bitmap->pixels), frameSize);
+      }
+      offset += entry.size;
+
+      const std::string name = movie.getName(i);
+      entry.nameOffset = names.size();
+      entry.nameSize = name.size();
+      names += name;
+      index.push_back(entry);
+
+      if (!oStream) {
+         throw std::runtime_error{"Failed writing to " + fileName + "."};
+      }
+      if (progress && !progress(i + 1)) {
+         cancelled = true;
+      }
+   }
+
+   if (cancelled) {
+      return false;
+   }
+
+   align();
+   header.indexOffset = offset;
+   oStream.write(reinterpret_cast<const char*>(index.data()),
+      index.size() * sizeof(IndexEntry));
+   offset += index.size() * sizeof(IndexEntry);
+
+   header.namesOffset = offset;
+   header.namesSize = names.size();
+   oStream.write(names.data(), names.size());
+
+   oStream.seekp(0);
+   oStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+   oStream.close();
+
+   if (!oStream) {
+      throw std::runtime_error{"Failed writing to " + fileName + "."};
+   }
+
+   boost::system::error_code error;
+   boost::filesystem::rename(temporary.name, fileName, error);
+   if (error) {
+      throw std::runtime_error{"Can't replace " + fileName + ": " + error.message()};
+   }
+   temporary.kept = true;
+   return true;
+}
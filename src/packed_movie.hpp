@@ -0,0 +1,84 @@
+#ifndef PACKED_MOVIE_H
+#define PACKED_MOVIE_H
+
+#include <cstddef>    // size_t
+#include <cstdint>    // uint32_t, uint64_t
+#include <functional> // function
+#include <memory>     // shared_ptr
+#include <string>
+
+#include "frame_source.hpp"
+
+class Movie;
+
+namespace boost { namespace interprocess { class mapped_region; } }
+
+// A whole movie in one file (extension .thm): a header, the 8-bit frames in row-major
+// order, each starting on a page boundary and optionally PackBits-compressed, and an
+// index holding every frame's position, size and original name.  All integers are little
+// endian.  The file is memory-mapped; uncompressed frames are used in place.
+class PackedSource : public FrameSource
+{
+   public:
+
+   // Throws std::runtime_error if the file can't be mapped or isn't a packed movie.
+   explicit PackedSource(const std::string& fileName);
+
+   virtual std::string getDir() const override;
+   virtual std::size_t size() const override;
+   virtual std::string getName(std::size_t) const override;
+   virtual std::shared_ptr<const Bitmap> load(std::size_t) const override;
+
+   struct Header
+   {
+      char          magic[8]; // "THMOVIE" and a null character
+      std::uint32_t version;
+      std::uint32_t alignment; // of the frames' offsets
+      std::uint32_t width, height;
+      std::uint64_t frameCount;
+      std::uint64_t indexOffset; // frameCount IndexEntry objects
+      std::uint64_t namesOffset, namesSize;
+   };
+
+   struct IndexEntry
+   {
+      std::uint64_t offset, size; // of the stored frame
+      std::uint32_t compression;  // one of the constants below
+      std::uint32_t nameOffset, nameSize; // relative to Header::namesOffset
+      std::uint32_t reserved;
+   };
+
+   static constexpr std::uint32_t version = 1;
+   static constexpr std::uint32_t alignment = 4096;
+   static constexpr std::uint32_t uncompressed = 0, packBitsCompressed = 1;
+
+   private:
+
+   IndexEntry getEntry(std::size_t) const;
+
+   std::shared_ptr<boost::interprocess::mapped_region> region;
+   const Byte* data; // the mapped file
+   std::size_t fileSize;
+
+   Header header;
+   std::string dir;
+};
+
+inline std::string PackedSource::getDir() const {
+   return dir;
+}
+
+inline std::size_t PackedSource::size() const {
+   return header.frameCount;
+}
+
+// Write all frames of a movie to a packed movie file.  If compress is true, frames that
+// get smaller when PackBits-encoded are stored that way.  progress is called with the
+// number of frames written so far and can return false to cancel, in which case false is
+// returned.  Throws std::runtime_error on I/O errors.  The file is written under a
+// temporary name next to it and only renamed once complete, so if packing is cancelled
+// or fails, no partial file is left and an existing one stays as it was.
+bool packMovie(const Movie&, const std::string& fileName, bool compress,
+   const std::function<bool(std::size_t)>& progress = nullptr);
+
+#endif //PACKED_MOVIE_H
@@ -0,0 +1,186 @@
+#include <algorithm> // max, min
+#include <cstdint>   // int16_t, uint16_t
+#include <cstring>   // memcpy
+#include <limits>
+#include <stdexcept> // runtime_error
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#define BOOST_FILESYSTEM_NO_DEPRECATED // Exclude deprecated features from headers.
+#include <boost/filesystem.hpp>
+
+#include "directory_scan.hpp"
+#include "phase_source.hpp"
+
+namespace {
+   std::size_t sampleSize(PhaseSource::SampleType type) {
+      return type == PhaseSource::SampleType::float32 ? 4 : 2;
+   }
+
+   // Samples needn't be aligned in the file; memcpy() compiles to a plain load.
+   template<class Sample>
+   float sampleAt(const Byte* samples, std::size_t i)
+   {
+      Sample sample;
+      std::memcpy(&sample, samples + i * sizeof(Sample), sizeof(Sample));
+      return float(sample);
+   }
+
+   // Written so the compiler can vectorize it.  Comparisons with NaN are false, so NaNs
+   // become 0.
+   template<class Sample>
+   void convert(const Byte* samples, std::size_t count, float low, float scale,
+      Byte* pixels)
+   {
+      for (std::size_t i = 0; i < count; ++i)
+      {
+         float value = (sampleAt<Sample>(samples, i) - low) * scale + .5f;
+         value = value > 0.f ? value : 0.f;
+         value = value < 255.f ? value : 255.f;
+         pixels[i] = Byte(int(value));
+      }
+   }
+
+   template<class Sample>
+   void widen(const Byte* samples, std::size_t count, float* values)
+   {
+      for (std::size_t i = 0; i < count; ++i) {
+         values[i] = sampleAt<Sample>(samples, i);
+      }
+   }
+}
+
+PhaseSource::PhaseSource(const std::string& dir, const std::string& regEx,
+   const Format& format, Range range) :
+   dir{dir}, names{}, format(format), range(range)
+{
+   using boost::filesystem::path;
+
+   // Append a directory separator if necessary, so concatenation works as expected.
+   if (this->dir.empty() || this->dir.back() != path::preferred_separator) {
+      this->dir += path::preferred_separator;
+   }
+
+   std::size_t files;
+   bool byIndex;
+   for (const auto& name : matchDirectory(this->dir, regEx, files, byIndex)) {
+      names.push_back(name);
+   }
+   if (names.empty()) {
+      throw std::runtime_error{"No file in " + dir + " matches " + regEx + "."};
+   }
+   if (!format.width || !format.height) {
+      throw std::runtime_error{"The phase images need a size."};
+   }
+
+   const Byte* samples;
+   map(0, samples); // Fail early if the format doesn't fit.
+
+   if (range.low < range.high) {
+      return;
+   }
+
+   // Take the range of the samples of a few frames spread over the movie.
+   float low = std::numeric_limits<float>::max();
+   float high = std::numeric_limits<float>::lowest();
+   const std::size_t count = format.width * format.height;
+   const std::size_t step = std::max<std::size_t>(names.size() / 8, 1);
+   for (std::size_t i = 0; i < names.size(); i += step)
+   {
+      auto values = loadSamples(i);
+      for (std::size_t j = 0; j < count; ++j)
+      {
+         const float value = values.get()[j];
+         if (value != value) continue; // NaN
+         low = std::min(low, value);
+         high = std::max(high, value);
+      }
+   }
+
+   if (!(low < high)) { // all the same or all NaN
+      low = low <= high ? low : 0.f;
+      high = low + 1.f;
+   }
+   this->range = Range{low, high};
+}
+
+std::shared_ptr<const Bitmap> PhaseSource::load(std::size_t i) const
+{
+   const Byte* samples;
+   auto mapping = map(i, samples);
+
+   auto bitmap = std::make_shared<Bitmap>(format.width, format.height);
+   const std::size_t count = format.width * format.height;
+   const float scale = 255.f / (range.high - range.low);
+
+   switch (format.type)
+   {
+      case SampleType::float32:
+         convert<float>(samples, count, range.low, scale, bitmap->pixels);
+         break;
+      case SampleType::uint16:
+         convert<std::uint16_t>(samples, count, range.low, scale, bitmap->pixels);
+         break;
+      case SampleType::int16:
+         convert<std::int16_t>(samples, count, range.low, scale, bitmap->pixels);
+         break;
+   }
+   return bitmap;
+}
+
+std::shared_ptr<const float> PhaseSource::loadSamples(std::size_t i) const
+{
+   const Byte* samples;
+   auto mapping = map(i, samples);
+
+   if (format.type == SampleType::float32 &&
+       reinterpret_cast<std::uintptr_t>(samples) % alignof(float) == 0)
+   {
+      // Share ownership of the mapping.
+      return std::shared_ptr<const float>{mapping,
+         reinterpret_cast<const float*>(samples)};
+   }
+
+   const std::size_t count = format.width * format.height;
+   std::shared_ptr<float> values{new float[count], std::default_delete<float[]>{}};
+   switch (format.type)
+   {
+      case SampleType::float32:
+         widen<float>(samples, count, values.get());
+         break;
+      case SampleType::uint16:
+         widen<std::uint16_t>(samples, count, values.get());
+         break;
+      case SampleType::int16:
+         widen<std::int16_t>(samples, count, values.get());
+         break;
+   }
+   return values;
+}
+
+std::shared_ptr<const void> PhaseSource::map(std::size_t i, const Byte*& samples) const
+{
+   using namespace boost::interprocess;
+
+   const std::string fileName = dir + names[i];
+   std::shared_ptr<mapped_region> region;
+   try {
+      file_mapping mapping{fileName.c_str(), read_only};
+      region = std::make_shared<mapped_region>(mapping, read_only);
+   }
+   catch (const interprocess_exception& exception) {
+      throw std::runtime_error{"Can't map " + fileName + ": " + exception.what()};
+   }
+
+   const std::uint64_t bytes =
+      std::uint64_t{format.width} * format.height * sampleSize(format.type);
+   if (format.offset > region->get_size() ||
+       bytes > region->get_size() - format.offset)
+   {
+      throw std::runtime_error{fileName + " is too small for the given image size."};
+   }
+
+   samples = static_cast<const Byte*>(region->get_address()) + format.offset;
+   return region;
+}
@@ -0,0 +1,80 @@
+#ifndef PHASE_SOURCE_H
+#define PHASE_SOURCE_H
+
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <memory>  // shared_ptr
+#include <string>
+
+#include "frame_source.hpp"
+#include "name_index.hpp"
+
+// Raw phase images as written by holographic microscopes: one file per frame holding
+// width * height samples of 32-bit floats or 16-bit integers (native byte order) after a
+// header of a given size.  Files are selected and ordered like a DirectorySource does.
+// Each file is memory-mapped and converted to 8 bits in one pass, mapping a range of
+// sample values to 0 to 255; the range is either fixed or found once for the whole movie
+// from the samples of a few frames.  The samples are also available at full precision.
+class PhaseSource : public FrameSource
+{
+   public:
+
+   enum class SampleType { float32, uint16, int16 };
+
+   struct Format
+   {
+      std::size_t   width, height;
+      std::uint64_t offset; // of the samples in a file
+      SampleType    type;
+   };
+
+   // Sample values mapped to 0 and 255; values beyond are clamped and NaNs become 0.
+   struct Range
+   {
+      float low, high;
+   };
+
+   // If range is empty (low isn't less than high), it's found from the data.  Throws
+   // std::runtime_error if no file matches or the first one is too small for the format.
+   PhaseSource(const std::string& directory, const std::string& regEx, const Format&,
+               Range = Range{0.f, 0.f});
+
+   virtual std::string getDir() const override;
+   virtual std::size_t size() const override;
+   virtual std::string getName(std::size_t) const override;
+   virtual std::shared_ptr<const Bitmap> load(std::size_t) const override;
+
+   Range getRange() const;
+
+   // The samples of a frame as floats, e.g. for tracking at full precision.  Float files
+   // are used in place.
+   std::shared_ptr<const float> loadSamples(std::size_t) const;
+
+   private:
+
+   // Map a file; throws std::runtime_error if it can't be or is too small.
+   std::shared_ptr<const void> map(std::size_t, const Byte*& samples) const;
+
+   std::string dir;
+   NameIndex names;
+   Format format;
+   Range range;
+};
+
+inline std::string PhaseSource::getDir() const {
+   return dir;
+}
+
+inline std::size_t PhaseSource::size() const {
+   return names.size();
+}
+
+inline std::string PhaseSource::getName(std::size_t i) const {
+   return names[i];
+}
+
+inline PhaseSource::Range PhaseSource::getRange() const {
+   return range;
+}
+
+#endif //PHASE_SOURCE_H
@@ -0,0 +1,81 @@
+#include <algorithm> // max, min, sort
+#include <cmath>     // abs
+#include <utility>   // pair
+
+#include "prefetcher.hpp"
+
+Prefetcher::Prefetcher(std::size_t ahead, std::size_t behind, std::size_t maxAhead,
+   double lookAhead) :
+   ahead{std::max<std::size_t>(ahead, 1)}, behind{behind},
+   maxAhead{std::max(ahead, maxAhead)},
+   lookAhead{lookAhead}
+{
+   reset();
+}
+
+std::vector<std::size_t> Prefetcher::update(std::size_t newPosition,
+   std::size_t frameCount)
+{
+   const auto now = Clock::now();
+
+   if (hasPosition)
+   {
+      const long delta = long(newPosition) - long(position);
+      const double seconds = std::chrono::duration<double>(now - time).count();
+
+      if (std::size_t(std::abs(delta)) > reach + 1) { // Not scrubbing; start over.
+         velocity = 0.;
+      }
+      else if (delta && seconds > 0.)
+      {
+         // Exponential smoothing; slider events don't arrive at a steady pace.
+         velocity = .5 * velocity + .5 * double(std::abs(delta)) / seconds;
+         direction = delta > 0 ? 1 : -1;
+      }
+   }
+
+   hasPosition = true;
+   position = newPosition;
+   time = now;
+
+   const std::size_t forward = std::min(maxAhead,
+      std::max(ahead, std::size_t(velocity * lookAhead)));
+   // The window behind the position grows in proportion.
+   const std::size_t backward = behind * forward / ahead;
+   reach = forward;
+
+   // Weigh distances so the frames behind are interleaved with those ahead in proportion
+   // to the sizes of the windows.
+   std::vector<std::pair<double, std::size_t>> candidates;
+   for (std::size_t i = 1; i <= forward; ++i)
+   {
+      long index = long(position) + direction * long(i);
+      if (index >= 0 && std::size_t(index) < frameCount) {
+         candidates.emplace_back(double(i), std::size_t(index));
+      }
+   }
+   for (std::size_t i = 1; i <= backward; ++i)
+   {
+      long index = long(position) - direction * long(i);
+      if (index >= 0 && std::size_t(index) < frameCount) {
+         candidates.emplace_back(double(i) * forward / backward, std::size_t(index));
+      }
+   }
+   std::sort(candidates.begin(), candidates.end());
+
+   std::vector<std::size_t> indices;
+   indices.reserve(candidates.size());
+   for (const auto& candidate : candidates) {
+      indices.push_back(std::get<1>(candidate));
+   }
+   return indices;
+}
+
+void Prefetcher::reset()
+{
+   hasPosition = false;
+   position = 0;
+   velocity = 0.;
+   direction = 1;
+   reach = ahead;
+}
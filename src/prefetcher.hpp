@@ -0,0 +1,42 @@
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <chrono>
+#include <cstddef> // size_t
+#include <vector>
+
+// Decides which frames to decode ahead of time while the user moves through a movie.  It
+// keeps track of the position's velocity and returns a window of frames reaching further
+// in the direction of movement the faster it is, plus a smaller one behind the position.
+class Prefetcher
+{
+   public:
+
+   // The windows are given in frames; ahead is stretched to cover lookAhead seconds of
+   // movement at the current velocity, but never beyond maxAhead.
+   Prefetcher(std::size_t ahead = 16, std::size_t behind = 4, std::size_t maxAhead = 256,
+              double lookAhead = .5);
+
+   // Return the frames to prefetch for the new position, nearest (weighted by direction)
+   // first.  When the position leaves the previous window, the user jumped rather than
+   // scrubbed and the velocity is reset.
+   std::vector<std::size_t> update(std::size_t position, std::size_t frameCount);
+
+   void reset();
+
+   private:
+
+   typedef std::chrono::steady_clock Clock;
+
+   std::size_t ahead, behind, maxAhead;
+   double lookAhead;
+
+   bool              hasPosition;
+   std::size_t       position;
+   Clock::time_point time;
+   double            velocity;  // in frames per second; smoothed
+   int               direction; // 1 or -1
+   std::size_t       reach;     // how far the last window extended in direction
+};
+
+#endif //PREFETCHER_H
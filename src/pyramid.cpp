@@ -0,0 +1,37 @@
+#include "pyramid.hpp"
+
+constexpr std::size_t Pyramid::tileSize;
+
+namespace {
+   std::shared_ptr<const Bitmap> halve(const Bitmap& source)
+   {
+      const std::size_t width = (source.width + 1) / 2, height = (source.height + 1) / 2;
+      auto bitmap = std::make_shared<Bitmap>(width, height);
+
+      // Pairs of rows and columns, then the odd ones left at the edges.
+      const std::size_t pairs = source.width / 2;
+      for (std::size_t y = 0; y < height; ++y)
+      {
+         const Byte* top = source[2 * y];
+         const Byte* bottom = 2 * y + 1 < source.height ? source[2 * y + 1] : top;
+         Byte* target = (*bitmap)[y];
+         for (std::size_t x = 0; x < pairs; ++x)
+         {
+            target[x] = Byte((top[2 * x] + top[2 * x + 1] + bottom[2 * x] +
+                              bottom[2 * x + 1] + 2) / 4);
+         }
+         if (pairs < width) {
+            target[pairs] = Byte((top[2 * pairs] + bottom[2 * pairs] + 1) / 2);
+         }
+      }
+      return bitmap;
+   }
+}
+
+Pyramid::Pyramid(std::shared_ptr<const Bitmap> frame)
+{
+   levels.push_back(std::move(frame));
+   while (levels.back()->width > tileSize || levels.back()->height > tileSize) {
+      levels.push_back(halve(*levels.back()));
+   }
+}
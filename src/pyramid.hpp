@@ -0,0 +1,54 @@
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include <cstddef> // size_t
+#include <memory>  // shared_ptr
+#include <vector>
+
+#include "bitmap.hpp"
+
+// A frame and copies of it halved again and again, down to one that fits in a tile, for
+// showing parts of large frames at any scale without resampling all of them.  Level 0 is
+// the frame itself; each pixel of a further level is the mean of 2 x 2 pixels of the one
+// before (of 2 or 1 at odd edges).  The levels are cut into tiles of tileSize x tileSize
+// pixels (fewer at the right and bottom edges) when drawn.
+class Pyramid
+{
+   public:
+
+   static constexpr std::size_t tileSize = 256;
+
+   explicit Pyramid(std::shared_ptr<const Bitmap>);
+
+   Pyramid(const Pyramid&) = delete;
+   Pyramid& operator=(const Pyramid&) = delete;
+
+   std::size_t getLevelCount() const;
+   const Bitmap& getLevel(std::size_t) const;
+
+   // The number of tiles in a row or column of a level.
+   std::size_t getColumns(std::size_t level) const;
+   std::size_t getRows(std::size_t level) const;
+
+   private:
+
+   std::vector<std::shared_ptr<const Bitmap>> levels;
+};
+
+inline std::size_t Pyramid::getLevelCount() const {
+   return levels.size();
+}
+
+inline const Bitmap& Pyramid::getLevel(std::size_t level) const {
+   return *levels[level];
+}
+
+inline std::size_t Pyramid::getColumns(std::size_t level) const {
+   return (levels[level]->width + tileSize - 1) / tileSize;
+}
+
+inline std::size_t Pyramid::getRows(std::size_t level) const {
+   return (levels[level]->height + tileSize - 1) / tileSize;
+}
+
+#endif //PYRAMID_H
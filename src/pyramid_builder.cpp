@@ -0,0 +1,27 @@
+#include "pyramid_builder.hpp"
+
+PyramidBuilder::PyramidBuilder(Handler handler) :
+   worker{
+      [](const Request& request, std::shared_ptr<const Pyramid>& pyramid) {
+         std::shared_ptr<const Bitmap> bitmap = request.movie->getBitmap(request.index);
+         if (bitmap) {
+            pyramid = std::make_shared<Pyramid>(std::move(bitmap));
+         }
+         return bool(pyramid); // If not, the view keeps drawing the frame as a whole.
+      },
+      [handler](const Request& request, std::shared_ptr<const Pyramid>& pyramid) {
+         handler(request.index, request.tag, std::move(pyramid));
+      }
+   }
+{
+}
+
+void PyramidBuilder::request(const Movie& movie, std::size_t index, unsigned long tag)
+{
+   worker.request(Request{&movie, index, tag});
+}
+
+void PyramidBuilder::cancel()
+{
+   worker.cancel();
+}
@@ -0,0 +1,55 @@
+#ifndef PYRAMID_BUILDER_H
+#define PYRAMID_BUILDER_H
+
+#include <cstddef>    // size_t
+#include <functional> // function
+#include <memory>     // shared_ptr
+
+#include "latest_request_worker.hpp"
+#include "movie.hpp"
+#include "pyramid.hpp"
+
+// Builds Pyramids of frames of a Movie on a thread of its own, for zoomed-in views.  Like
+// a FramePreparer, it only serves the latest request: one that wasn't started yet when
+// the next one comes is dropped, and so is a pyramid that was built after its request
+// was superseded.
+class PyramidBuilder
+{
+   public:
+
+   // Called on the building thread with the frame's index, the tag of the request and
+   // the pyramid.
+   typedef std::function<void(std::size_t index, unsigned long tag,
+                              std::shared_ptr<const Pyramid>)> Handler;
+
+   // The thread stops when the builder goes.
+   explicit PyramidBuilder(Handler);
+
+   // Build the pyramid of a frame instead of the one requested before; does nothing if
+   // the same one is being built or waiting already.  The movie has to stay until the
+   // pyramid is handled or cancel() returns.
+   void request(const Movie&, std::size_t index, unsigned long tag);
+
+   // Drop the waiting request and wait until no pyramid is being built, e.g. before the
+   // movie goes.
+   void cancel();
+
+   private:
+
+   struct Request
+   {
+      const Movie* movie;
+      std::size_t index;
+      unsigned long tag;
+
+      bool operator==(const Request&) const;
+   };
+
+   LatestRequestWorker<Request, std::shared_ptr<const Pyramid>> worker;
+};
+
+inline bool PyramidBuilder::Request::operator==(const Request& other) const {
+   return movie == other.movie && index == other.index && tag == other.tag;
+}
+
+#endif //PYRAMID_BUILDER_H
@@ -0,0 +1,52 @@
+#include <cassert>
+
+#include "read_ahead.hpp"
+
+ReadAhead::ReadAhead(const Movie& movie, std::vector<std::size_t> order, Band band,
+   std::size_t depth) :
+   movie(movie), order{std::move(order)}, band{std::move(band)},
+   depth{depth ? depth : 1}, cursor{0}, requested{0},
+   banded(this->order.size(), false) {}
+
+ReadAhead::~ReadAhead()
+{
+   for (std::size_t i = cursor; i < requested; ++i) {
+      if (!banded[i]) movie.unpin(order[i]);
+   }
+}
+
+std::shared_ptr<const Bitmap> ReadAhead::next(std::size_t index, std::size_t first,
+   std::size_t last)
+{
+   assert (cursor < order.size() && order[cursor] == index);
+
+   // Keep the window filled.  Pinning before requesting makes sure a frame decoded by a
+   // loader thread stays cached until it is consumed.
+   for (; requested < order.size() && requested < cursor + depth; ++requested)
+   {
+      std::size_t bandFirst, bandLast;
+      if (band && band(requested, bandFirst, bandLast))
+      {
+         banded[requested] = true;
+         movie.requestRows(order[requested], bandFirst, bandLast);
+      }
+      else
+      {
+         movie.pin(order[requested]);
+         movie.request(order[requested], FrameLoader::Priority::high);
+      }
+   }
+
+   std::shared_ptr<const Bitmap> bitmap;
+   if (banded[cursor]) {
+      bitmap = movie.getRows(index, first, last);
+   }
+   else
+   {
+      bitmap = movie.getBitmap(index);
+      movie.unpin(index);
+   }
+   ++cursor;
+
+   return bitmap;
+}
@@ -0,0 +1,53 @@
+#ifndef READ_AHEAD_H
+#define READ_AHEAD_H
+
+#include <cstddef>    // size_t
+#include <functional> // function
+#include <limits>
+#include <memory>     // shared_ptr
+#include <vector>
+
+#include "bitmap.hpp"
+#include "movie.hpp"
+
+// Keeps the movie's loader threads decoding up to depth frames ahead of a consumer that
+// visits frames in a known order.  Frames between the consumer and the end of that window
+// are pinned in the frame cache, so they can't be evicted before they are used.  Of the
+// frames a band function picks, only a band of rows is decoded (see Movie::getRows()).
+class ReadAhead
+{
+   public:
+
+   // Set first and last (exclusive) to the rows of the frame at a position of the order
+   // that the consumer will need at most, as far as can be told when it's requested;
+   // false to have the whole frame decoded.
+   typedef std::function<bool(std::size_t position, std::size_t& first,
+                              std::size_t& last)> Band;
+
+   ReadAhead(const Movie&, std::vector<std::size_t> order, Band = nullptr,
+             std::size_t depth = 16);
+
+   ReadAhead(const ReadAhead&) = delete;
+   ReadAhead& operator=(const ReadAhead&) = delete;
+
+   ~ReadAhead(); // unpins the frames of the window
+
+   // Return the frame at the next position of the order, which has to be index; of a
+   // band, at least rows first to last.  Blocks only if the loader threads haven't caught
+   // up yet.
+   std::shared_ptr<const Bitmap> next(std::size_t index, std::size_t first = 0,
+      std::size_t last = std::numeric_limits<std::size_t>::max());
+
+   private:
+
+   const Movie& movie;
+   std::vector<std::size_t> order;
+   Band band;
+   std::size_t depth;
+
+   std::size_t cursor;    // position in order of the next frame to be returned
+   std::size_t requested; // position in order of the first frame not requested yet
+   std::vector<bool> banded; // by position; the others are pinned while in the window
+};
+
+#endif //READ_AHEAD_H
@@ -0,0 +1,163 @@
+#include <algorithm> // min
+#include <cstdint>   // uint64_t
+
+#include "rice.hpp"
+
+namespace {
+   const std::size_t blockSize = 32;
+   const unsigned escape = 15; // a quotient of escape is followed by the verbatim value
+
+   unsigned fold(Byte residual) {
+      return residual < 128 ? residual * 2u : (256u - residual) * 2u - 1u;
+   }
+
+   Byte unfold(unsigned value) {
+      return value & 1 ? Byte(256u - (value + 1) / 2) : Byte(value / 2);
+   }
+
+   // Bits are written starting with the least significant bit of each byte.
+   class BitWriter
+   {
+      public:
+
+      explicit BitWriter(std::vector<Byte>& bytes) : bytes(bytes), buffer{0}, count{0} {}
+
+      ~BitWriter() {
+         if (count) bytes.push_back(Byte(buffer));
+      }
+
+      void put(std::uint64_t bits, unsigned n) // n <= 32
+      {
+         buffer |= bits << count;
+         count += n;
+         while (count >= 8) {
+            bytes.push_back(Byte(buffer));
+            buffer >>= 8;
+            count -= 8;
+         }
+      }
+
+      private:
+
+      std::vector<Byte>& bytes;
+      std::uint64_t buffer;
+      unsigned count;
+   };
+
+   class BitReader
+   {
+      public:
+
+      BitReader(const Byte* begin, const Byte* end) :
+         next(begin), end(end), buffer{0}, count{0} {}
+
+      // false if there are fewer than n bits left; n <= 32
+      bool get(unsigned n, unsigned& bits)
+      {
+         while (count < n) {
+            if (next == end) return false;
+            buffer |= std::uint64_t{*next++} << count;
+            count += 8;
+         }
+         bits = unsigned(buffer & ((std::uint64_t{1} << n) - 1));
+         buffer >>= n;
+         count -= n;
+         return true;
+      }
+
+      // Count the one bits up to the next zero bit (which is consumed), but at most max.
+      bool getUnary(unsigned max, unsigned& ones)
+      {
+         ones = 0;
+         unsigned bit;
+         while (ones < max) {
+            if (!get(1, bit)) return false;
+            if (!bit) return true;
+            ++ones;
+         }
+         return true;
+      }
+
+      private:
+
+      const Byte* next;
+      const Byte* end;
+      std::uint64_t buffer;
+      unsigned count;
+   };
+}
+
+void riceEncode(const Byte* residuals, std::size_t size, std::vector<Byte>& encoded)
+{
+   BitWriter writer{encoded};
+   unsigned values[blockSize];
+
+   for (std::size_t begin = 0; begin < size; begin += blockSize)
+   {
+      const std::size_t n = std::min(blockSize, size - begin);
+      for (std::size_t i = 0; i < n; ++i) {
+         values[i] = fold(residuals[begin + i]);
+      }
+
+      // Choose the parameter yielding the fewest bits.
+      unsigned k = 0;
+      std::size_t bestBits = std::size_t(-1);
+      for (unsigned candidate = 0; candidate < 8; ++candidate)
+      {
+         std::size_t bits = 0;
+         for (std::size_t i = 0; i < n; ++i) {
+            unsigned quotient = values[i] >> candidate;
+            bits += quotient < escape ? quotient + 1 + candidate : escape + 8;
+         }
+         if (bits < bestBits) {
+            bestBits = bits;
+            k = candidate;
+         }
+      }
+
+      writer.put(k, 3);
+      for (std::size_t i = 0; i < n; ++i)
+      {
+         unsigned quotient = values[i] >> k;
+         if (quotient < escape) {
+            writer.put((std::uint64_t{1} << quotient) - 1, quotient + 1);
+            writer.put(values[i] & ((1u << k) - 1), k);
+         }
+         else {
+            writer.put((1u << escape) - 1, escape);
+            writer.put(values[i], 8);
+         }
+      }
+   }
+}
+
+bool riceDecode(const Byte* encoded, std::size_t encodedSize, Byte* residuals,
+   std::size_t size)
+{
+   BitReader reader{encoded, encoded + encodedSize};
+
+   for (std::size_t begin = 0; begin < size; begin += blockSize)
+   {
+      const std::size_t n = std::min(blockSize, size - begin);
+
+      unsigned k;
+      if (!reader.get(3, k)) return false;
+
+      for (std::size_t i = 0; i < n; ++i)
+      {
+         unsigned quotient, value;
+         if (!reader.getUnary(escape, quotient)) return false;
+         if (quotient < escape)
+         {
+            unsigned remainder = 0;
+            if (k && !reader.get(k, remainder)) return false;
+            value = quotient << k | remainder;
+         }
+         else if (!reader.get(8, value)) {
+            return false;
+         }
+         residuals[begin + i] = unfold(value);
+      }
+   }
+   return true;
+}
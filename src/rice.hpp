@@ -0,0 +1,22 @@
+#ifndef RICE_H
+#define RICE_H
+
+#include <cstddef> // size_t
+#include <vector>
+
+#include "bitmap.hpp" // Byte
+
+// Adaptive Rice coding of prediction residuals, i.e. of differences between pixels (mod
+// 256) that are mostly close to zero.  Residuals are mapped to unsigned values (0, -1, 1,
+// -2, ... become 0, 1, 2, 3, ...) and coded in blocks of 32 with the parameter that
+// minimizes the size of each block.  Values whose quotient would exceed 14 are escaped
+// and stored verbatim, so no residual costs more than 15 + 8 bits.
+
+// Append the encoded residuals to encoded.
+void riceEncode(const Byte* residuals, std::size_t size, std::vector<Byte>& encoded);
+
+// Return false if the encoded data ends before size residuals are decoded.
+bool riceDecode(const Byte* encoded, std::size_t encodedSize, Byte* residuals,
+   std::size_t size);
+
+#endif //RICE_H
@@ -0,0 +1,106 @@
+#include <algorithm> // max, max_element, min
+#include <cstdint>   // uint16_t, uint32_t
+#include <vector>
+
+#include "scale_gray.hpp"
+
+namespace {
+   const std::uint32_t one = 1 << 16; // weight of a whole source pixel
+
+   // The source pixels each output pixel along an axis is made of.
+   struct Taps
+   {
+      std::vector<std::size_t>   starts;  // of the taps of each output pixel, and the end
+      std::vector<std::size_t>   indices; // of the source pixels
+      std::vector<std::uint32_t> weights; // adding up to one for each output pixel
+   };
+
+   Taps makeTaps(std::size_t from, std::size_t to)
+   {
+      Taps taps;
+      const double scale = double(from) / to; // source pixels per output pixel
+      std::vector<double> weights;
+      for (std::size_t i = 0; i < to; ++i)
+      {
+         std::size_t first;
+         weights.clear();
+         if (scale > 1.)
+         {
+            const double begin = i * scale, end = std::min((i + 1) * scale, double(from));
+            first = std::size_t(begin);
+            for (std::size_t j = first; j < end; ++j) {
+               weights.push_back(std::min(end, j + 1.) - std::max(begin, double(j)));
+            }
+         }
+         else
+         {
+            // Pixel centers map to pixel centers.
+            const double x = std::min(std::max((i + .5) * scale - .5, 0.), from - 1.);
+            first = std::size_t(x);
+            weights.push_back(1. - (x - first));
+            if (first + 1 < from) weights.push_back(x - first);
+         }
+
+         // in fixed point; the rounding error goes to the largest weight
+         double total = 0.;
+         for (double weight : weights) total += weight;
+         taps.starts.push_back(taps.indices.size());
+         std::uint32_t sum = 0;
+         for (std::size_t j = 0; j < weights.size(); ++j)
+         {
+            taps.indices.push_back(first + j);
+            taps.weights.push_back(std::uint32_t(weights[j] / total * one + .5));
+            sum += taps.weights.back();
+         }
+         *std::max_element(taps.weights.begin() + taps.starts.back(), taps.weights.end())
+            += one - sum;
+      }
+      taps.starts.push_back(taps.indices.size());
+      return taps;
+   }
+}
+
+std::shared_ptr<const Bitmap> scaleGray(const Bitmap& source, std::size_t width,
+   std::size_t height)
+{
+   const Taps columns = makeTaps(source.width, width), rows = makeTaps(source.height,
+      height);
+
+   // Rows first, into 8.8 fixed point, so rounding happens once per pass.
+   std::vector<std::uint16_t> scaledRows(width * source.height);
+   for (std::size_t y = 0; y < source.height; ++y)
+   {
+      const Byte* sourceRow = source[y];
+      std::uint16_t* target = &scaledRows[y * width];
+      for (std::size_t x = 0; x < width; ++x)
+      {
+         std::uint32_t sum = 0;
+         for (std::size_t i = columns.starts[x]; i < columns.starts[x + 1]; ++i) {
+            sum += sourceRow[columns.indices[i]] * columns.weights[i];
+         }
+         target[x] = std::uint16_t((sum + (1 << 7)) >> 8);
+      }
+   }
+
+   // Then columns, a row of sums at a time; the sums stay below 2^32 since the weights
+   // of an output pixel add up to one.
+   auto bitmap = std::make_shared<Bitmap>(width, height);
+   std::vector<std::uint32_t> sums(width);
+   for (std::size_t y = 0; y < height; ++y)
+   {
+      std::fill(sums.begin(), sums.end(), 1 << 23);
+      for (std::size_t i = rows.starts[y]; i < rows.starts[y + 1]; ++i)
+      {
+         const std::uint16_t* sourceRow = &scaledRows[rows.indices[i] * width];
+         const std::uint32_t weight = rows.weights[i];
+         for (std::size_t x = 0; x < width; ++x) {
+            sums[x] += sourceRow[x] * weight;
+         }
+      }
+      Byte* target = (*bitmap)[y];
+      for (std::size_t x = 0; x < width; ++x) {
+         target[x] = Byte(sums[x] >> 24);
+      }
+   }
+   return bitmap;
+}
@@ -0,0 +1,17 @@
+#ifndef SCALE_GRAY_H
+#define SCALE_GRAY_H
+
+#include <cstddef> // size_t
+#include <memory>  // shared_ptr
+
+#include "bitmap.hpp"
+
+// Resample a bitmap to width x height pixels.  Along an axis it is shrunk, each pixel is
+// the mean of the source pixels it covers, weighted by how much of them it does (a box
+// filter); along an axis it is enlarged, pixels are interpolated linearly between the
+// nearest two.  Unlike nearest-neighbour sampling, this doesn't drop thin features or
+// make them flicker from frame to frame.
+std::shared_ptr<const Bitmap> scaleGray(const Bitmap&, std::size_t width,
+   std::size_t height);
+
+#endif //SCALE_GRAY_H
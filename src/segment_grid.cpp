@@ -0,0 +1,200 @@
+#include <algorithm> // find_if, max, min, sort, unique
+#include <cmath>     // floor, sqrt
+
+#include "segment_grid.hpp"
+
+constexpr int SegmentGrid::cellSize;
+
+namespace {
+   const Point unknown{-1, -1};
+
+   // The segment starting at point i of a track; a point followed by an unknown one is a
+   // segment of its own.  False if point i isn't known.
+   bool getSegment(const Track& track, std::size_t i, Point& from, Point& to)
+   {
+      from = track[i];
+      if (from == unknown) return false;
+      to = i + 1 < track.size() && track[i + 1] != unknown ? track[i + 1] : from;
+      return true;
+   }
+
+   // The squared distance of (x, y) from the segment, and where the nearest point of the
+   // segment is (0 at from, 1 at to).
+   double squaredDistance(double x, double y, const Point& from, const Point& to,
+      double& t)
+   {
+      const double dX = to.x - from.x, dY = to.y - from.y;
+      const double squaredLength = dX * dX + dY * dY;
+      t = squaredLength ? ((x - from.x) * dX + (y - from.y) * dY) / squaredLength : 0.;
+      t = std::min(std::max(t, 0.), 1.);
+      const double nearestX = from.x + t * dX - x, nearestY = from.y + t * dY - y;
+      return nearestX * nearestX + nearestY * nearestY;
+   }
+}
+
+void SegmentGrid::update(std::uint32_t id, const std::shared_ptr<const Track>& track)
+{
+   IndexedTrack& indexed = tracks[id];
+   indexed.track = track;
+
+   // Read the version first: a point set meanwhile is caught by the next update.
+   const std::uint32_t version = track->getVersion();
+   if (version == indexed.version) {
+      return;
+   }
+   indexed.version = version;
+
+   const std::uint32_t blockCount = std::uint32_t(track->getBlockCount());
+   for (std::uint32_t block = blockCount; block < indexed.cells.size(); ++block) {
+      unindex(id, indexed, block);
+   }
+   indexed.blockVersions.resize(blockCount, 0);
+   indexed.cells.resize(blockCount);
+
+   // The last segment of a block ends in the next one.
+   std::vector<bool> changed(blockCount + 1, false);
+   for (std::uint32_t block = 0; block < blockCount; ++block)
+   {
+      const std::uint32_t blockVersion = track->getBlockVersion(block);
+      if (blockVersion != indexed.blockVersions[block])
+      {
+         indexed.blockVersions[block] = blockVersion;
+         changed[block] = true;
+         if (block) changed[block - 1] = true;
+      }
+   }
+   for (std::uint32_t block = 0; block < blockCount; ++block)
+   {
+      if (!changed[block]) continue;
+      unindex(id, indexed, block);
+      index(id, indexed, *track, block);
+   }
+}
+
+void SegmentGrid::erase(std::uint32_t id)
+{
+   auto found = tracks.find(id);
+   if (found == tracks.end()) {
+      return;
+   }
+   for (std::uint32_t block = 0; block < found->second.cells.size(); ++block) {
+      unindex(id, found->second, block);
+   }
+   tracks.erase(found);
+}
+
+void SegmentGrid::clear()
+{
+   tracks.clear();
+   cells.clear();
+}
+
+std::vector<SegmentGrid::Block> SegmentGrid::query(int left, int top, int right,
+   int bottom) const
+{
+   std::vector<Block> blocks;
+   if (right < 0 || bottom < 0) {
+      return blocks;
+   }
+
+   const int firstColumn = std::max(left, 0) / cellSize, lastColumn = right / cellSize,
+      firstRow = std::max(top, 0) / cellSize, lastRow = bottom / cellSize;
+   for (int row = firstRow; row <= lastRow; ++row)
+   {
+      for (int column = firstColumn; column <= lastColumn; ++column)
+      {
+         auto found = cells.find(cellKey(column, row));
+         if (found != cells.end()) {
+            blocks.insert(blocks.end(), found->second.begin(), found->second.end());
+         }
+      }
+   }
+
+   std::sort(blocks.begin(), blocks.end(), [](const Block& a, const Block& b) {
+         return a.track < b.track || (a.track == b.track && a.block < b.block);
+      }
+   );
+   blocks.erase(std::unique(blocks.begin(), blocks.end(),
+         [](const Block& a, const Block& b) {
+            return a.track == b.track && a.block == b.block;
+         }
+      ), blocks.end());
+   return blocks;
+}
+
+bool SegmentGrid::hitTest(double x, double y, double maxDistance, Hit& hit) const
+{
+   double nearest = maxDistance * maxDistance;
+   bool found = false;
+   for (const Block& candidate : query(int(std::floor(x - maxDistance)),
+           int(std::floor(y - maxDistance)), int(std::floor(x + maxDistance)),
+           int(std::floor(y + maxDistance))))
+   {
+      std::shared_ptr<const Track> track = tracks.at(candidate.track).track.lock();
+      if (!track) continue;
+
+      const std::size_t end = std::min((candidate.block + 1) * Track::blockSize,
+                                       track->size());
+      for (std::size_t i = candidate.block * Track::blockSize; i < end; ++i)
+      {
+         Point from, to;
+         double t;
+         if (!getSegment(*track, i, from, to)) continue;
+         const double distance = squaredDistance(x, y, from, to, t);
+         if (distance <= nearest)
+         {
+            nearest = distance;
+            hit = Hit{candidate.track, t < .5 || from == to ? i : i + 1, 0.};
+            found = true;
+         }
+      }
+   }
+   hit.distance = std::sqrt(nearest);
+   return found;
+}
+
+void SegmentGrid::index(std::uint32_t id, IndexedTrack& indexed, const Track& track,
+   std::uint32_t block)
+{
+   std::vector<std::uint32_t>& blockCells = indexed.cells[block];
+   const std::size_t end = std::min((block + 1) * Track::blockSize, track.size());
+   for (std::size_t i = block * Track::blockSize; i < end; ++i)
+   {
+      Point from, to;
+      if (!getSegment(track, i, from, to)) continue;
+      const int firstColumn = std::min(from.x, to.x) / cellSize,
+         lastColumn = std::max(from.x, to.x) / cellSize,
+         firstRow = std::min(from.y, to.y) / cellSize,
+         lastRow = std::max(from.y, to.y) / cellSize;
+      for (int row = firstRow; row <= lastRow; ++row) {
+         for (int column = firstColumn; column <= lastColumn; ++column) {
+            blockCells.push_back(cellKey(column, row));
+         }
+      }
+   }
+
+   std::sort(blockCells.begin(), blockCells.end());
+   blockCells.erase(std::unique(blockCells.begin(), blockCells.end()), blockCells.end());
+   for (std::uint32_t key : blockCells) {
+      cells[key].push_back(Block{id, block});
+   }
+}
+
+void SegmentGrid::unindex(std::uint32_t id, IndexedTrack& indexed, std::uint32_t block)
+{
+   for (std::uint32_t key : indexed.cells[block])
+   {
+      auto found = cells.find(key);
+      std::vector<Block>& blocks = found->second;
+      auto entry = std::find_if(blocks.begin(), blocks.end(), [&](const Block& b) {
+            return b.track == id && b.block == block;
+         }
+      );
+      *entry = blocks.back();
+      blocks.pop_back();
+      if (blocks.empty()) {
+         cells.erase(found);
+      }
+   }
+   indexed.cells[block].clear();
+}
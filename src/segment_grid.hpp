@@ -0,0 +1,72 @@
+#ifndef SEGMENT_GRID_H
+#define SEGMENT_GRID_H
+
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t
+#include <memory>  // shared_ptr, weak_ptr
+#include <unordered_map>
+#include <vector>
+
+#include "track.hpp"
+
+// A uniform grid over the segments of tracks (in bitmap coordinates), for finding the
+// ones in a rectangle or near a point without looking at all of them.  The segments of a
+// track are indexed in its blocks of Track::blockSize points: a cell lists the blocks
+// having a segment (from one of their known points to the next point, if that's known)
+// whose bounding box overlaps the cell.  Updates follow the block versions of the
+// tracks, so only blocks that changed are indexed again.  Tracks are told apart by ids
+// chosen by the user.  Not thread-safe.
+class SegmentGrid
+{
+   public:
+
+   static constexpr int cellSize = 64; // in bitmap pixels
+
+   struct Block
+   {
+      std::uint32_t track, block;
+   };
+
+   struct Hit
+   {
+      std::uint32_t track;
+      std::size_t   index;    // of the point nearest to where the segment was hit
+      double        distance; // from the segment
+   };
+
+   // Index the blocks of a track that changed since the last update.
+   void update(std::uint32_t track, const std::shared_ptr<const Track>&);
+   void erase(std::uint32_t track);
+   void clear();
+
+   // The blocks with segments in the rectangle from (left, top) to (right, bottom),
+   // inclusive; each once, ordered by track and block.
+   std::vector<Block> query(int left, int top, int right, int bottom) const;
+
+   // The segment nearest to (x, y) within maxDistance; false if there is none.
+   bool hitTest(double x, double y, double maxDistance, Hit&) const;
+
+   private:
+
+   struct IndexedTrack
+   {
+      std::weak_ptr<const Track> track;
+      std::uint32_t version = 0;                     // of the track when last updated
+      std::vector<std::uint32_t> blockVersions;      // ditto
+      std::vector<std::vector<std::uint32_t>> cells; // of each block
+   };
+
+   static std::uint32_t cellKey(int column, int row);
+
+   void index(std::uint32_t track, IndexedTrack&, const Track&, std::uint32_t block);
+   void unindex(std::uint32_t track, IndexedTrack&, std::uint32_t block);
+
+   std::unordered_map<std::uint32_t, IndexedTrack> tracks;
+   std::unordered_map<std::uint32_t, std::vector<Block>> cells; // by cellKey()
+};
+
+inline std::uint32_t SegmentGrid::cellKey(int column, int row) {
+   return std::uint32_t(row) << 16 | std::uint32_t(column);
+}
+
+#endif //SEGMENT_GRID_H
@@ -0,0 +1,251 @@
+#include <algorithm> // find
+#include <cstdlib>   // strtoul
+#include <cstring>   // memcmp
+#include <sstream>   // istringstream
+#include <stdexcept> // runtime_error
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#define BOOST_FILESYSTEM_NO_DEPRECATED // Exclude deprecated features from headers.
+#include <boost/filesystem.hpp>
+
+#include "stream_source.hpp"
+
+namespace {
+   // how often a growing file is checked
+   const boost::posix_time::milliseconds watchInterval{250};
+
+   // longest header line accepted, of the stream or of a frame
+   const std::size_t maxHeaderSize = 4096;
+
+   const char streamMagic[] = "YUV4MPEG2 ";
+   const char frameMagic[] = "FRAME";
+}
+
+StreamSource::StreamSource(const std::string& fileName, Listener listener) :
+   fileName{fileName}, y4m{true}, width{0}, height{0}, frameBytes{0}, region{},
+   mappedSize{0}, firstOffset{0}, offsets{}, scanned{0}, frameCount{0},
+   listener{std::move(listener)}
+{
+   // The header has to be there already; it tells the size of the frames.
+   std::shared_ptr<boost::interprocess::mapped_region> headerRegion;
+   try
+   {
+      using namespace boost::interprocess;
+      file_mapping mapping{fileName.c_str(), read_only};
+      headerRegion = std::make_shared<mapped_region>(mapping, read_only);
+   }
+   catch (const boost::interprocess::interprocess_exception& exception) {
+      throw std::runtime_error{"Can't map " + fileName + ": " + exception.what()};
+   }
+
+   const char* data = static_cast<const char*>(headerRegion->get_address());
+   const std::size_t size = std::min(headerRegion->get_size(), maxHeaderSize);
+   const char* end = std::find(data, data + size, '\n');
+   if (end == data + size || std::size_t(end - data) < sizeof(streamMagic) - 1 ||
+       std::memcmp(data, streamMagic, sizeof(streamMagic) - 1))
+   {
+      throw std::runtime_error{fileName + " is not a YUV4MPEG2 stream."};
+   }
+
+   // Parameters are separated by spaces and start with a letter telling which they are.
+   std::string colorSpace = "420jpeg";
+   std::istringstream iStream{std::string{data + sizeof(streamMagic) - 1, end}};
+   std::string parameter;
+   while (iStream >> parameter)
+   {
+      if (parameter[0] == 'W') width = std::strtoul(parameter.c_str() + 1, nullptr, 10);
+      if (parameter[0] == 'H') height = std::strtoul(parameter.c_str() + 1, nullptr, 10);
+      if (parameter[0] == 'C') colorSpace = parameter.substr(1);
+   }
+   if (!width || !height) {
+      throw std::runtime_error{fileName + " lacks the frame size."};
+   }
+
+   // Only the luma plane is used, but the chroma planes have to be skipped.
+   const std::uint64_t lumaBytes = std::uint64_t{width} * height;
+   const std::uint64_t halfWidth = (width + 1) / 2, halfHeight = (height + 1) / 2;
+   if (colorSpace == "420jpeg" || colorSpace == "420paldv" || colorSpace == "420mpeg2" ||
+       colorSpace == "420")
+   {
+      frameBytes = lumaBytes + 2 * halfWidth * halfHeight;
+   }
+   else if (colorSpace == "422") {
+      frameBytes = lumaBytes + 2 * halfWidth * height;
+   }
+   else if (colorSpace == "411") {
+      frameBytes = lumaBytes + 2 * ((width + 3) / 4) * height;
+   }
+   else if (colorSpace == "444") {
+      frameBytes = 3 * lumaBytes;
+   }
+   else if (colorSpace == "444alpha") {
+      frameBytes = 4 * lumaBytes;
+   }
+   else if (colorSpace == "mono") {
+      frameBytes = lumaBytes;
+   }
+   else {
+      throw std::runtime_error{fileName + " has an unsupported color space (C" +
+         colorSpace + "); only 8-bit samples can be read."};
+   }
+
+   scanned = std::uint64_t(end - data) + 1;
+   init(fileName);
+}
+
+StreamSource::StreamSource(const std::string& fileName, const RawFormat& format,
+   Listener listener) :
+   fileName{fileName}, y4m{false}, width{format.width}, height{format.height},
+   frameBytes{std::uint64_t{format.width} * format.height}, region{}, mappedSize{0},
+   firstOffset{format.offset}, offsets{}, scanned{0}, frameCount{0},
+   listener{std::move(listener)}
+{
+   if (!frameBytes) {
+      throw std::runtime_error{"The frames of " + fileName + " need a size."};
+   }
+   if (!boost::filesystem::is_regular_file(fileName)) {
+      throw std::runtime_error{"Can't open " + fileName + "."};
+   }
+   init(fileName);
+}
+
+StreamSource::~StreamSource()
+{
+   if (watcher.joinable())
+   {
+      watcher.interrupt();
+      watcher.join();
+   }
+}
+
+void StreamSource::init(const std::string& fileName)
+{
+   using boost::filesystem::path;
+
+   const path absolute = boost::filesystem::absolute(fileName);
+   dir = absolute.parent_path().make_preferred().string();
+   if (dir.empty() || dir.back() != path::preferred_separator) {
+      dir += path::preferred_separator;
+   }
+   stem = absolute.stem().string();
+   extension = absolute.extension().string();
+
+   refresh();
+
+   if (listener) {
+      watcher = boost::thread{&StreamSource::watch, this};
+   }
+}
+
+std::size_t StreamSource::size() const
+{
+   boost::shared_lock<boost::shared_mutex> lock{mutex};
+   return frameCount;
+}
+
+std::string StreamSource::getName(std::size_t i) const
+{
+   std::string number = std::to_string(i);
+   if (number.size() < 6) number.insert(0, 6 - number.size(), '0');
+   return stem + '_' + number + extension;
+}
+
+std::shared_ptr<const Bitmap> StreamSource::load(std::size_t i) const
+{
+   boost::shared_lock<boost::shared_mutex> lock{mutex};
+   if (i >= frameCount) {
+      throw std::out_of_range{"frame " + std::to_string(i) + " isn't there yet"};
+   }
+
+   const std::uint64_t offset = y4m ? offsets[i] : firstOffset + i * frameBytes;
+   Byte* data = static_cast<Byte*>(region->get_address());
+
+   // The frames keep the mapping they point into alive, even after the file was mapped
+   // again.
+   return std::make_shared<Bitmap>(width, height, data + offset, region);
+}
+
+bool StreamSource::refresh()
+{
+   boost::system::error_code error;
+   const std::uint64_t fileSize = boost::filesystem::file_size(fileName, error);
+   if (error) {
+      return false;
+   }
+
+   boost::lock_guard<boost::shared_mutex> lock{mutex};
+   if (fileSize <= mappedSize) {
+      return false;
+   }
+
+   try
+   {
+      using namespace boost::interprocess;
+      file_mapping mapping{fileName.c_str(), read_only};
+      region = std::make_shared<mapped_region>(mapping, read_only);
+      mappedSize = region->get_size();
+   }
+   catch (const boost::interprocess::interprocess_exception&) {
+      return false; // e.g. replaced in the meantime; try again later
+   }
+
+   const Byte* data = static_cast<const Byte*>(region->get_address());
+   std::size_t count;
+   if (y4m)
+   {
+      indexFrames(data, mappedSize);
+      count = offsets.size();
+   }
+   else {
+      count = mappedSize < firstOffset ? 0 : (mappedSize - firstOffset) / frameBytes;
+   }
+
+   if (count <= frameCount) {
+      return false;
+   }
+   frameCount = count;
+   return true;
+}
+
+void StreamSource::indexFrames(const Byte* data, std::uint64_t fileSize)
+{
+   const std::size_t magicSize = sizeof(frameMagic) - 1;
+   while (fileSize - scanned >= magicSize)
+   {
+      if (std::memcmp(data + scanned, frameMagic, magicSize)) {
+         return; // corrupt; keep the frames up to here
+      }
+
+      // Frame headers may carry parameters, too.
+      const Byte* header = data + scanned;
+      const std::size_t available = std::size_t(std::min<std::uint64_t>(
+         fileSize - scanned, maxHeaderSize));
+      const Byte* end = std::find(header, header + available, '\n');
+      if (end == header + available) {
+         return; // not complete yet, or corrupt
+      }
+      const std::uint64_t luma = scanned + std::uint64_t(end - header) + 1;
+      if (luma > fileSize || frameBytes > fileSize - luma) {
+         return; // not complete yet
+      }
+
+      offsets.push_back(luma);
+      scanned = luma + frameBytes;
+   }
+}
+
+void StreamSource::watch()
+{
+   try
+   {
+      for (;;)
+      {
+         boost::this_thread::sleep(watchInterval);
+         if (refresh()) listener(false);
+      }
+   }
+   catch (const boost::thread_interrupted&) {
+   }
+}
@@ -0,0 +1,95 @@
+#ifndef STREAM_SOURCE_H
+#define STREAM_SOURCE_H
+
+#include <cstddef>    // size_t
+#include <cstdint>    // uint64_t
+#include <functional> // function
+#include <memory>     // shared_ptr
+#include <string>
+#include <vector>
+
+#define BOOST_THREAD_USE_LIB
+#include <boost/thread.hpp> // thread, shared_mutex
+
+#include "frame_source.hpp"
+
+namespace boost { namespace interprocess { class mapped_region; } }
+
+// The frames of a video stream in one file: either a YUV4MPEG2 stream (extension .y4m,
+// 8-bit samples; the luma plane is used) or raw 8-bit grayscale frames of a size given
+// by the user, following a header of a given size.  The file is memory-mapped and frames
+// are used in place, addressed by their byte offsets.
+//
+// If a listener is given, the file may still be growing, e.g. while a camera records to
+// it: a thread of its own checks the file's size regularly, publishes the frames that
+// were completed in the meantime (size() grows) and calls the listener.  Only whole
+// frames are ever published.  All members are thread-safe.
+class StreamSource : public FrameSource
+{
+   public:
+
+   typedef std::function<void(bool complete)> Listener; // complete is always false
+
+   struct RawFormat
+   {
+      std::size_t   width, height;
+      std::uint64_t offset; // of the first frame
+   };
+
+   // A YUV4MPEG2 stream.  Throws std::runtime_error if the file can't be opened or its
+   // header can't be read.
+   explicit StreamSource(const std::string& fileName, Listener = nullptr);
+
+   // Raw frames.  Throws std::runtime_error if the file can't be opened.
+   StreamSource(const std::string& fileName, const RawFormat&, Listener = nullptr);
+
+   // Stops watching the file.
+   ~StreamSource();
+
+   StreamSource(const StreamSource&) = delete;
+   StreamSource& operator=(const StreamSource&) = delete;
+
+   virtual std::string getDir() const override;
+   virtual std::size_t size() const override;
+
+   // e.g. "cells_000042.y4m" for frame 42 of cells.y4m
+   virtual std::string getName(std::size_t) const override;
+
+   virtual std::shared_ptr<const Bitmap> load(std::size_t) const override;
+
+   private:
+
+   void init(const std::string& fileName);
+
+   // Map the file again if it grew and publish the frames completed since; true if there
+   // are new ones.
+   bool refresh();
+
+   // Index the frame headers of a YUV4MPEG2 stream from scanned on; the mutex has to be
+   // held exclusively.
+   void indexFrames(const Byte* data, std::uint64_t fileSize);
+
+   void watch();
+
+   std::string fileName, dir, stem, extension;
+   bool y4m;
+   std::size_t width, height;
+   std::uint64_t frameBytes; // including the chroma planes of YUV4MPEG2 streams
+
+   std::shared_ptr<boost::interprocess::mapped_region> region; // nullptr if empty
+   std::uint64_t mappedSize;
+   std::uint64_t firstOffset;          // of the first raw frame
+   std::vector<std::uint64_t> offsets; // of the luma planes of YUV4MPEG2 frames
+   std::uint64_t scanned;              // offset of the next YUV4MPEG2 frame header
+   std::size_t frameCount;             // published
+
+   Listener listener;
+   mutable boost::shared_mutex mutex; // guards region, the index and frameCount
+   boost::thread watcher;
+};
+
+inline std::string StreamSource::getDir() const {
+   return dir;
+}
+
+#endif //STREAM_SOURCE_H
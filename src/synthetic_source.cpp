@@ -0,0 +1,156 @@
+#include <algorithm> // max, min
+#include <cmath>     // cos, floor, fmod, sin
+#include <cstdint>   // uint64_t
+#include <random>    // mt19937, uniform_real_distribution
+#include <stdexcept> // invalid_argument
+
+#define BOOST_FILESYSTEM_NO_DEPRECATED // Exclude deprecated features from headers.
+#include <boost/filesystem.hpp>
+
+#include "synthetic_source.hpp"
+
+namespace {
+   const double pi = 3.14159265358979323846;
+
+   const unsigned background = 32, peak = 224; // intensities
+
+   // Reflect a coordinate that moved freely from low on into [low, high].
+   double bounce(double value, double low, double high)
+   {
+      const double span = high - low;
+      if (span <= 0.) return low;
+      double offset = std::fmod(value - low, 2. * span);
+      if (offset < 0.) offset += 2. * span;
+      return low + (offset > span ? 2. * span - offset : offset);
+   }
+
+   // A fast generator for the noise, seeded per frame so frames can be rendered in any
+   // order and on any thread (xorshift64*, with splitmix64 scrambling the seed).
+   class Noise
+   {
+      public:
+
+      Noise(unsigned seed, std::size_t frame)
+      {
+         state = (std::uint64_t{seed} << 32) + frame + 0x9e3779b97f4a7c15;
+         state = (state ^ state >> 30) * 0xbf58476d1ce4e5b9;
+         state = (state ^ state >> 27) * 0x94d049bb133111eb;
+         state ^= state >> 31;
+         if (!state) state = 1;
+      }
+
+      std::uint64_t operator()()
+      {
+         state ^= state >> 12;
+         state ^= state << 25;
+         state ^= state >> 27;
+         return state * 0x2545f4914f6cdd1d;
+      }
+
+      private:
+
+      std::uint64_t state;
+   };
+}
+
+SyntheticSource::SyntheticSource(const Parameters& parameters) :
+   parameters(parameters), dir{}, blobs{}
+{
+   if (parameters.width < 2 * parameters.radius + 2 ||
+       parameters.height < 2 * parameters.radius + 2)
+   {
+      throw std::invalid_argument{"The frames are too small for the blobs."};
+   }
+
+   using boost::filesystem::path;
+   boost::system::error_code error;
+   dir = boost::filesystem::temp_directory_path(error).make_preferred().string();
+   if (dir.empty() || dir.back() != path::preferred_separator) {
+      dir += path::preferred_separator;
+   }
+
+   std::mt19937 engine{parameters.seed};
+   std::uniform_real_distribution<double> unit{0., 1.};
+   for (unsigned i = 0; i < parameters.blobCount; ++i)
+   {
+      const double angle = 2. * pi * unit(engine);
+      Blob blob;
+      blob.x = parameters.radius + unit(engine) * (parameters.width - 1 -
+         2 * parameters.radius);
+      blob.y = parameters.radius + unit(engine) * (parameters.height - 1 -
+         2 * parameters.radius);
+      blob.dx = parameters.speed * std::cos(angle);
+      blob.dy = parameters.speed * std::sin(angle);
+      blobs.push_back(blob);
+   }
+}
+
+std::string SyntheticSource::getName(std::size_t i) const
+{
+   std::string number = std::to_string(i);
+   if (number.size() < 6) number.insert(0, 6 - number.size(), '0');
+   return "synthetic_" + number;
+}
+
+std::shared_ptr<const Bitmap> SyntheticSource::load(std::size_t i) const
+{
+   const std::size_t width = parameters.width, height = parameters.height;
+   auto bitmap = std::make_shared<Bitmap>(width, height);
+
+   // Each random number gives the noise of eight pixels, scaled from a byte each.
+   Noise noise{parameters.seed, i};
+   const unsigned range = std::min(parameters.noise, 255u - background) + 1;
+   Byte* pixel = bitmap->pixels;
+   for (std::size_t j = 0; j < width * height; j += 8)
+   {
+      std::uint64_t bits = noise();
+      for (std::size_t k = j; k < std::min(j + 8, width * height); ++k, bits >>= 8) {
+         *pixel++ = Byte(background + ((bits & 0xff) * range >> 8));
+      }
+   }
+
+   // Each blob's intensity falls off with the square of the distance from its center, so
+   // its brightest pixel is the one nearest to the center.  Overlapping blobs add up.
+   const double radius = parameters.radius, squaredRadius = radius * radius;
+   for (unsigned blob = 0; blob < blobs.size(); ++blob)
+   {
+      double x, y;
+      getPosition(blob, i, x, y);
+      const std::size_t firstRow = std::size_t(std::max(std::floor(y - radius), 0.)),
+         lastRow = std::min(std::size_t(y + radius), height - 1),
+         firstColumn = std::size_t(std::max(std::floor(x - radius), 0.)),
+         lastColumn = std::min(std::size_t(x + radius), width - 1);
+
+      for (std::size_t row = firstRow; row <= lastRow; ++row)
+      {
+         Byte* pixels = (*bitmap)[row];
+         for (std::size_t column = firstColumn; column <= lastColumn; ++column)
+         {
+            const double squaredDistance = (column - x) * (column - x) +
+               (row - y) * (row - y);
+            if (squaredDistance >= squaredRadius) continue;
+
+            const unsigned value = pixels[column] +
+               unsigned((peak - background) * (1. - squaredDistance / squaredRadius));
+            pixels[column] = Byte(std::min(value, 255u));
+         }
+      }
+   }
+   return bitmap;
+}
+
+Point SyntheticSource::getPosition(unsigned blob, std::size_t frame) const
+{
+   double x, y;
+   getPosition(blob, frame, x, y);
+   return Point{int(x + .5), int(y + .5)};
+}
+
+void SyntheticSource::getPosition(unsigned blob, std::size_t frame, double& x,
+   double& y) const
+{
+   const Blob& b = blobs[blob];
+   const double radius = parameters.radius;
+   x = bounce(b.x + b.dx * frame, radius, parameters.width - 1 - radius);
+   y = bounce(b.y + b.dy * frame, radius, parameters.height - 1 - radius);
+}
@@ -0,0 +1,75 @@
+#ifndef SYNTHETIC_SOURCE_H
+#define SYNTHETIC_SOURCE_H
+
+#include <cstddef> // size_t
+#include <memory>  // shared_ptr
+#include <string>
+#include <vector>
+
+#include "frame_source.hpp"
+#include "track.hpp"
+
+// A movie of bright blobs moving in straight lines over a dark, noisy background and
+// bouncing off its edges, rendered on demand.  Where each blob is in each frame is known,
+// so tracking can be checked and timed without any data on disk.  The same parameters
+// always give the same movie.
+class SyntheticSource : public FrameSource
+{
+   public:
+
+   struct Parameters
+   {
+      std::size_t width = 640, height = 480, frameCount = 1000;
+      unsigned blobCount = 8;
+      double radius = 6.; // in pixels
+      double speed = 2.;  // in pixels per frame
+      unsigned noise = 16; // largest value added to a pixel by noise
+      unsigned seed = 1;
+   };
+
+   // Throws std::invalid_argument if the frames are too small for the blobs.
+   explicit SyntheticSource(const Parameters&);
+
+   // the directory for temporary files
+   virtual std::string getDir() const override;
+
+   virtual std::size_t size() const override;
+
+   // e.g. "synthetic_000042"
+   virtual std::string getName(std::size_t) const override;
+
+   virtual std::shared_ptr<const Bitmap> load(std::size_t) const override;
+
+   const Parameters& getParameters() const;
+
+   // The center of a blob in a frame, rounded to the nearest pixel.
+   Point getPosition(unsigned blob, std::size_t frame) const;
+
+   private:
+
+   struct Blob
+   {
+      double x, y;   // in the first frame
+      double dx, dy; // per frame
+   };
+
+   void getPosition(unsigned blob, std::size_t frame, double& x, double& y) const;
+
+   Parameters parameters;
+   std::string dir;
+   std::vector<Blob> blobs;
+};
+
+inline std::string SyntheticSource::getDir() const {
+   return dir;
+}
+
+inline std::size_t SyntheticSource::size() const {
+   return parameters.frameCount;
+}
+
+inline const SyntheticSource::Parameters& SyntheticSource::getParameters() const {
+   return parameters;
+}
+
+#endif //SYNTHETIC_SOURCE_H
@@ -0,0 +1,331 @@
+#include <algorithm> // max, min
+#include <cstdlib>   // strtoull
+#include <cstring>   // memcmp
+#include <stdexcept> // runtime_error
+#include <unordered_set>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#define BOOST_FILESYSTEM_NO_DEPRECATED // Exclude deprecated features from headers.
+#include <boost/filesystem.hpp>
+
+#include "tiff_source.hpp"
+
+namespace {
+   enum Tag : unsigned
+   {
+      newSubfileType = 254, imageWidth = 256, imageLength = 257, bitsPerSampleTag = 258,
+      compression = 259, photometricInterpretation = 262, imageDescription = 270,
+      stripOffsets = 273, samplesPerPixel = 277, rowsPerStripTag = 278,
+      maxSampleValue = 281, tileWidth = 322
+   };
+
+   // The size of a value of a field type; 0 for unknown types.
+   unsigned typeSize(unsigned type)
+   {
+      switch (type)
+      {
+         case 1: case 2: case 6: case 7:                      return 1;
+         case 3: case 8:                                      return 2;
+         case 4: case 9: case 11: case 13:                    return 4;
+         case 5: case 10: case 12: case 16: case 17: case 18: return 8;
+         default:                                             return 0;
+      }
+   }
+
+   // Where the values of a directory entry are and how to read them.
+   struct Field
+   {
+      unsigned type = 0;
+      std::uint64_t count = 0;
+      std::uint64_t offset = 0; // of the values, which may lie in the entry itself
+   };
+}
+
+constexpr std::uint32_t TiffSource::noStrips;
+
+TiffSource::TiffSource(const std::string& fileName) :
+   bigEndian{false}, bigTiff{false}, width{0}, height{0}, bitsPerSample{0},
+   whiteIsZero{false}, maxSample{0}, stripCount{0}, rowsPerStrip{0}
+{
+   using namespace boost::interprocess;
+
+   try {
+      file_mapping mapping{fileName.c_str(), read_only};
+      region = std::make_shared<mapped_region>(mapping, read_only);
+   }
+   catch (const interprocess_exception& exception) {
+      throw std::runtime_error{"Can't map " + fileName + ": " + exception.what()};
+   }
+
+   data = static_cast<const Byte*>(region->get_address());
+   fileSize = region->get_size();
+
+   if (fileSize < 8 || (std::memcmp(data, "II", 2) && std::memcmp(data, "MM", 2))) {
+      throw std::runtime_error{fileName + " is not a TIFF file."};
+   }
+   bigEndian = data[0] == 'M';
+
+   std::uint64_t offset;
+   const std::uint64_t version = read(2, 2);
+   if (version == 42) {
+      offset = read(4, 4);
+   }
+   else if (version == 43 && read(4, 2) == 8 && fileSize >= 16) {
+      bigTiff = true;
+      offset = read(8, 8);
+   }
+   else {
+      throw std::runtime_error{fileName + " is not a TIFF file."};
+   }
+
+   // The directories may come in any order; don't get caught in a cycle.
+   std::unordered_set<std::uint64_t> visited;
+   std::string description; // of the first directory
+   try
+   {
+      while (offset && visited.insert(offset).second) {
+         offset = readDirectory(offset, description);
+      }
+   }
+   catch (const std::runtime_error&) {
+      // Keep the pages up to a truncated directory, e.g. of a file still being written.
+      if (pages.empty()) throw;
+   }
+
+   if (pages.empty()) {
+      throw std::runtime_error{fileName + " holds no uncompressed 8 or 16-bit grayscale "
+         "images."};
+   }
+
+   // ImageJ writes a directory for the first image only when a stack exceeds 4 GiB; the
+   // other images follow it.
+   const auto images = description.find("images=");
+   if (description.compare(0, 7, "ImageJ=") == 0 && images != std::string::npos &&
+       pages.size() == 1 && pages.front().firstStrip == noStrips)
+   {
+      const std::uint64_t count = std::strtoull(description.c_str() + images + 7,
+                                                nullptr, 10);
+      const std::uint64_t frameBytes = std::uint64_t{width} * height * bitsPerSample / 8;
+      for (std::uint64_t i = 1; i < count; ++i)
+      {
+         const std::uint64_t pageOffset = pages.front().offset + i * frameBytes;
+         if (pageOffset + frameBytes > fileSize) break;
+         pages.push_back(Page{pageOffset, noStrips});
+      }
+   }
+
+   if (bitsPerSample == 16 && !maxSample)
+   {
+      // Scale by the bit depth the camera seems to have, judging by a few pages spread
+      // over the stack.
+      unsigned largest = 0;
+      const std::size_t step = std::max<std::size_t>(pages.size() / 8, 1);
+      for (std::size_t i = 0; i < pages.size(); i += step)
+      {
+         for (std::size_t y = 0; y < height; ++y)
+         {
+            const Byte* samples = row(pages[i], y);
+            for (std::size_t x = 0; x < width; ++x) {
+               largest = std::max(largest, sample(samples + 2 * x));
+            }
+         }
+      }
+      for (maxSample = 255; maxSample < largest; maxSample = maxSample << 1 | 1) {}
+   }
+
+   using boost::filesystem::path;
+   const path absolute = boost::filesystem::absolute(fileName);
+   dir = absolute.parent_path().make_preferred().string();
+   if (dir.empty() || dir.back() != path::preferred_separator) {
+      dir += path::preferred_separator;
+   }
+   stem = absolute.stem().string();
+   extension = absolute.extension().string();
+
+   digits = 1;
+   for (std::size_t n = pages.size() - 1; n >= 10; n /= 10) ++digits;
+   digits = std::max(digits, 4u);
+}
+
+std::string TiffSource::getName(std::size_t i) const
+{
+   std::string number = std::to_string(i);
+   if (number.size() < digits) number.insert(0, digits - number.size(), '0');
+   return stem + '_' + number + extension;
+}
+
+std::shared_ptr<const Bitmap> TiffSource::load(std::size_t i) const
+{
+   const Page& page = pages[i];
+
+   if (bitsPerSample == 8 && page.firstStrip == noStrips && !whiteIsZero)
+   {
+      // Bitmap takes a non-const pointer but the frame is only ever handed out as const.
+      return std::make_shared<Bitmap>(width, height, const_cast<Byte*>(row(page, 0)),
+         region);
+   }
+
+   auto bitmap = std::make_shared<Bitmap>(width, height);
+   const Byte invert = whiteIsZero ? 0xff : 0;
+   for (std::size_t y = 0; y < height; ++y)
+   {
+      const Byte* source = row(page, y);
+      Byte* target = (*bitmap)[y];
+      if (bitsPerSample == 8)
+      {
+         for (std::size_t x = 0; x < width; ++x) {
+            target[x] = source[x] ^ invert;
+         }
+         continue;
+      }
+
+      for (std::size_t x = 0; x < width; ++x)
+      {
+         const unsigned value = std::min(sample(source + 2 * x), maxSample);
+         target[x] = Byte((value * 255 + maxSample / 2) / maxSample) ^ invert;
+      }
+   }
+   return bitmap;
+}
+
+const Byte* TiffSource::row(const Page& page, std::size_t y) const
+{
+   const std::size_t rowBytes = std::size_t{width} * bitsPerSample / 8;
+   if (page.firstStrip == noStrips) {
+      return data + page.offset + y * rowBytes;
+   }
+   return data + strips[page.firstStrip + y / rowsPerStrip] + y % rowsPerStrip * rowBytes;
+}
+
+std::uint64_t TiffSource::read(std::uint64_t offset, unsigned size) const
+{
+   if (offset > fileSize || size > fileSize - offset) {
+      throw std::runtime_error{"TIFF data beyond the end of the file"};
+   }
+
+   std::uint64_t value = 0;
+   for (unsigned i = 0; i < size; ++i)
+   {
+      const unsigned shift = bigEndian ? 8 * (size - 1 - i) : 8 * i;
+      value |= std::uint64_t{data[offset + i]} << shift;
+   }
+   return value;
+}
+
+std::uint64_t TiffSource::readDirectory(std::uint64_t offset, std::string& description)
+{
+   const unsigned countSize = bigTiff ? 8 : 2, entrySize = bigTiff ? 20 : 12,
+      valueSize = bigTiff ? 8 : 4;
+
+   const std::uint64_t entryCount = read(offset, countSize);
+   if (entryCount > fileSize / entrySize) {
+      throw std::runtime_error{"corrupt TIFF directory"};
+   }
+   const std::uint64_t entries = offset + countSize;
+   const std::uint64_t next = read(entries + entryCount * entrySize, valueSize);
+
+   Field fields[tileWidth + 1];
+   for (std::uint64_t i = 0; i < entryCount; ++i)
+   {
+      const std::uint64_t entry = entries + i * entrySize;
+      const unsigned tag = unsigned(read(entry, 2));
+      if (tag > tileWidth) continue;
+
+      Field& field = fields[tag];
+      field.type = unsigned(read(entry + 2, 2));
+      field.count = read(entry + 4, bigTiff ? 8 : 4);
+      field.offset = entry + 4 + (bigTiff ? 8 : 4);
+      const unsigned size = typeSize(field.type);
+      if (!size || field.count > fileSize / size) {
+         field.count = 0;
+      }
+      else if (field.count * size > valueSize) {
+         field.offset = read(field.offset, valueSize);
+      }
+   }
+
+   // The k-th value of a field, or fallback if it has none.
+   auto value = [&](unsigned tag, std::uint64_t k, std::uint64_t fallback) {
+      const Field& field = fields[tag];
+      if (k >= field.count) return fallback;
+      const unsigned size = typeSize(field.type);
+      return read(field.offset + k * size, std::min(size, 8u));
+   };
+
+   const Field& text = fields[imageDescription];
+   if (pages.empty() && text.type == 2 && text.offset <= fileSize &&
+       text.count <= fileSize - text.offset)
+   {
+      description.assign(reinterpret_cast<const char*>(data + text.offset),
+                         std::size_t(text.count));
+   }
+
+   const std::uint64_t pageWidth = value(imageWidth, 0, 0),
+      pageHeight = value(imageLength, 0, 0), bits = value(bitsPerSampleTag, 0, 1),
+      photometric = value(photometricInterpretation, 0, 1),
+      stripRows = std::min(value(rowsPerStripTag, 0, pageHeight), pageHeight);
+
+   if (value(newSubfileType, 0, 0) & 1 || // a thumbnail
+       !pageWidth || !pageHeight || pageWidth > 0xffffffff || pageHeight > 0xffffffff ||
+       (bits != 8 && bits != 16) || value(samplesPerPixel, 0, 1) != 1 ||
+       value(compression, 0, 1) != 1 || photometric > 1 || fields[tileWidth].count ||
+       !stripRows)
+   {
+      return next;
+   }
+
+   const std::uint32_t pageRowsPerStrip = std::uint32_t(stripRows);
+   const std::uint64_t pageStripCount = (pageHeight + stripRows - 1) / stripRows;
+   if (fields[stripOffsets].count < pageStripCount) {
+      return next;
+   }
+
+   if (pages.empty())
+   {
+      width = std::uint32_t(pageWidth);
+      height = std::uint32_t(pageHeight);
+      bitsPerSample = std::uint32_t(bits);
+      whiteIsZero = photometric == 0;
+      rowsPerStrip = pageRowsPerStrip;
+      stripCount = std::uint32_t(pageStripCount);
+      if (fields[maxSampleValue].count) {
+         maxSample = unsigned(std::max<std::uint64_t>(value(maxSampleValue, 0, 0), 1));
+      }
+   }
+   else if (pageWidth != width || pageHeight != height || bits != bitsPerSample ||
+            (photometric == 0) != whiteIsZero || pageRowsPerStrip != rowsPerStrip)
+   {
+      return next;
+   }
+
+   // Leave out pages that aren't completely in the file (yet).
+   const std::uint64_t rowBytes = std::uint64_t{width} * bitsPerSample / 8;
+   std::vector<std::uint64_t> pageStrips(stripCount);
+   bool contiguous = true;
+   for (std::uint32_t k = 0; k < stripCount; ++k)
+   {
+      const std::uint64_t rows = std::min<std::uint64_t>(rowsPerStrip,
+         height - std::uint64_t{k} * rowsPerStrip);
+      pageStrips[k] = value(stripOffsets, k, 0);
+      if (pageStrips[k] > fileSize || rows * rowBytes > fileSize - pageStrips[k]) {
+         return next;
+      }
+      contiguous = contiguous &&
+         pageStrips[k] == pageStrips[0] + std::uint64_t{k} * rowsPerStrip * rowBytes;
+   }
+
+   if (contiguous) {
+      pages.push_back(Page{pageStrips[0], noStrips});
+   }
+   else
+   {
+      if (strips.size() > noStrips - stripCount) {
+         throw std::runtime_error{"too many TIFF strips"};
+      }
+      pages.push_back(Page{0, std::uint32_t(strips.size())});
+      strips.insert(strips.end(), pageStrips.begin(), pageStrips.end());
+   }
+   return next;
+}
@@ -0,0 +1,94 @@
+#ifndef TIFF_SOURCE_H
+#define TIFF_SOURCE_H
+
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t, uint64_t
+#include <memory>  // shared_ptr
+#include <string>
+#include <vector>
+
+#include "frame_source.hpp"
+
+namespace boost { namespace interprocess { class mapped_region; } }
+
+// The pages of a multi-page TIFF file (extensions .tif and .tiff), as written by
+// microscopy software: uncompressed, one sample per pixel of 8 or 16 bits, in strips.
+// Classic and BigTIFF files of either byte order are read, and so are ImageJ stacks that
+// only describe their first page.  The chain of image file directories is parsed once
+// when the source is constructed, so any page is found in constant time after that.
+// Pages of another size than the first one and reduced-resolution pages (thumbnails) are
+// left out.  The file is memory-mapped; 8-bit pages stored in one piece are used in
+// place, 16-bit ones are scaled to 8 bits by the maximum sample value (the
+// MaxSampleValue tag, or else the largest sample of a few pages rounded up to a power of
+// two minus 1).
+class TiffSource : public FrameSource
+{
+   public:
+
+   // Throws std::runtime_error if the file can't be mapped or has no supported pages.
+   explicit TiffSource(const std::string& fileName);
+
+   virtual std::string getDir() const override;
+   virtual std::size_t size() const override;
+
+   // e.g. "cells_00042.tif" for page 42 of cells.tif
+   virtual std::string getName(std::size_t) const override;
+
+   virtual std::shared_ptr<const Bitmap> load(std::size_t) const override;
+
+   private:
+
+   struct Page
+   {
+      std::uint64_t offset;     // of the pixels, if stored in one piece
+      std::uint32_t firstStrip; // into strips, or noStrips if stored in one piece
+   };
+
+   static constexpr std::uint32_t noStrips = ~std::uint32_t{0};
+
+   // Read an unsigned integer of the file's byte order; throws std::runtime_error if it
+   // lies beyond the end of the file.
+   std::uint64_t read(std::uint64_t offset, unsigned size) const;
+
+   // The pixels of row y of a page.
+   const Byte* row(const Page&, std::size_t y) const;
+
+   // A 16-bit sample of the file's byte order.
+   unsigned sample(const Byte*) const;
+
+   // Parse the directory at offset and add its page unless it's left out.  Returns the
+   // offset of the next directory.
+   std::uint64_t readDirectory(std::uint64_t offset, std::string& description);
+
+   std::shared_ptr<boost::interprocess::mapped_region> region;
+   const Byte* data; // the mapped file
+   std::uint64_t fileSize;
+
+   bool bigEndian, bigTiff;
+   std::uint32_t width, height, bitsPerSample;
+   bool whiteIsZero;
+   unsigned maxSample; // of 16-bit samples; 0 until known
+
+   std::vector<Page> pages;
+   std::vector<std::uint64_t> strips; // offsets of the strips of pages stored in pieces
+   std::uint32_t stripCount;          // per page
+   std::uint32_t rowsPerStrip;
+
+   std::string dir, stem, extension;
+   unsigned digits; // of page numbers in names
+};
+
+inline std::string TiffSource::getDir() const {
+   return dir;
+}
+
+inline std::size_t TiffSource::size() const {
+   return pages.size();
+}
+
+inline unsigned TiffSource::sample(const Byte* bytes) const {
+   return bigEndian ? unsigned(bytes[0]) << 8 | bytes[1] :
+                      unsigned(bytes[1]) << 8 | bytes[0];
+}
+
+#endif //TIFF_SOURCE_H
@@ -1,6 +1,10 @@
 #ifndef TRACK_H
 #define TRACK_H
 
+#include <atomic>
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t
+#include <memory>  // unique_ptr
 #include <vector>
 
 struct Point
@@ -15,6 +19,106 @@ inline bool operator!=(const Point& rHS, const Point& lHS) {
    return !(rHS == lHS);
 }
 
-typedef std::vector<Point> Track;
+// The points of a trackee, one per frame; {-1, -1} where it isn't known.  Each change
+// bumps the version of the track and that of the block of blockSize points it falls
+// into, so views can find out what changed since they last looked without comparing all
+// points.  Versions start at 1.  They may be read while another thread sets points;
+// resize() mustn't overlap anything else, though.
+class Track
+{
+   public:
+
+   static constexpr std::size_t blockSize = 256;
+
+   typedef std::vector<Point>::const_iterator const_iterator;
+
+   Track(std::size_t size, const Point&);
+
+   Track(const Track&) = delete;
+   Track& operator=(const Track&) = delete;
+
+   std::size_t size() const;
+   const Point& operator[](std::size_t) const;
+   const_iterator begin() const;
+   const_iterator end() const;
+
+   void set(std::size_t, const Point&);
+   void resize(std::size_t, const Point&);
+
+   std::uint32_t getVersion() const;
+   std::size_t getBlockCount() const;
+   std::uint32_t getBlockVersion(std::size_t block) const;
+
+   private:
+
+   std::vector<Point> points;
+   std::unique_ptr<std::atomic<std::uint32_t>[]> blockVersions;
+   std::atomic<std::uint32_t> version;
+};
+
+inline Track::Track(std::size_t size, const Point& point) :
+   points(size, point),
+   blockVersions{new std::atomic<std::uint32_t>[(size + blockSize - 1) / blockSize]},
+   version{1}
+{
+   for (std::size_t block = 0; block < getBlockCount(); ++block) {
+      blockVersions[block].store(1, std::memory_order_relaxed);
+   }
+}
+
+inline std::size_t Track::size() const {
+   return points.size();
+}
+
+inline const Point& Track::operator[](std::size_t i) const {
+   return points[i];
+}
+
+inline Track::const_iterator Track::begin() const {
+   return points.begin();
+}
+
+inline Track::const_iterator Track::end() const {
+   return points.end();
+}
+
+inline void Track::set(std::size_t i, const Point& point)
+{
+   if (points[i] == point) return;
+   points[i] = point;
+   blockVersions[i / blockSize].fetch_add(1, std::memory_order_release);
+   version.fetch_add(1, std::memory_order_release);
+}
+
+inline void Track::resize(std::size_t size, const Point& point)
+{
+   const std::size_t oldCount = getBlockCount();
+   points.resize(size, point);
+
+   std::unique_ptr<std::atomic<std::uint32_t>[]> newVersions{
+      new std::atomic<std::uint32_t>[getBlockCount()]};
+   for (std::size_t block = 0; block < getBlockCount(); ++block)
+   {
+      // The last old block may have gained points.
+      const std::uint32_t blockVersion = block + 1 < oldCount ?
+         blockVersions[block].load(std::memory_order_relaxed) :
+         block < oldCount ? blockVersions[block].load(std::memory_order_relaxed) + 1 : 1;
+      newVersions[block].store(blockVersion, std::memory_order_relaxed);
+   }
+   blockVersions = std::move(newVersions);
+   version.fetch_add(1, std::memory_order_release);
+}
+
+inline std::uint32_t Track::getVersion() const {
+   return version.load(std::memory_order_acquire);
+}
+
+inline std::size_t Track::getBlockCount() const {
+   return (points.size() + blockSize - 1) / blockSize;
+}
+
+inline std::uint32_t Track::getBlockVersion(std::size_t block) const {
+   return blockVersions[block].load(std::memory_order_acquire);
+}
 
 #endif //TRACK_H
@@ -1,26 +1,75 @@
-#include <algorithm>  // find_if
+#include <algorithm>  // lower_bound, max, min
 #include <array>
 #include <bitset>
 #include <cassert>
-#include <cmath>      // round
-#include <functional> // bind
+#include <cmath>      // floor, pow, round
+#include <cstdlib>    // abs
 
 //#include <iostream>
 
 #include <wx/dcbuffer.h> // wxBufferedPaintDC
 #include <wx/graphics.h> // wxGraphicsContext
+#include <wx/image.h>
 #include <wx/menu.h>
 #include <wx/rawbmp.h>
 #include <wx/sizer.h>
 
+#include "expand_gray.hpp"
 #include "track_panel.hpp"
 
+namespace {
+   const wxPoint unknown{-1, -1};
+
+   const double zoomStep = 1.25; // per notch of the mouse wheel
+   const double maxZoom = 64.;
+
+   const std::size_t tileCacheSize = 64; // tiles of up to 192 KiB, at least
+
+   const double pickDistance = 5.; // device pixels from a track
+
+   // Add points[from, to) to path: a line through each run of known points.  If extend
+   // is true, a run continues from points[from - 1], which has to be the last point of
+   // path.  Points no more than tolerance device pixels away from the last one added (in
+   // either direction) are left out unless they end a run, so the cost of stroking a long
+   // track depends on the pixels it covers rather than on the number of frames; a
+   // negative tolerance keeps all points.  Returns one past the last known point, or from
+   // if there is none.
+   std::size_t appendToPath(wxGraphicsPath& path, wxPoint& last,
+      const std::vector<wxPoint>& points, std::size_t from, std::size_t to, bool extend,
+      int tolerance)
+   {
+      std::size_t end = from;
+      for (std::size_t i = from; i < to; ++i)
+      {
+         const wxPoint& point = points[i];
+         if (point == unknown) continue;
+         if (i == 0 || points[i - 1] == unknown || (i == from && !extend))
+         {
+            path.MoveToPoint(point.x, point.y);
+            last = point;
+         }
+         else if (i + 1 == to || points[i + 1] == unknown ||
+                  std::abs(point.x - last.x) > tolerance ||
+                  std::abs(point.y - last.y) > tolerance)
+         {
+            path.AddLineToPoint(point.x, point.y);
+            last = point;
+         }
+         end = i + 1;
+      }
+      return end;
+   }
+}
+
 TrackPanel::TrackPanel(wxWindow* parent, wxWindowID id, const wxPoint& pos,
    const wxSize& size) :
    wxPanel{parent, id, pos, size},
-   bitmap{},
+   bitmap{}, scaledBitmap{}, scaledSize{}, scaledImage{}, pyramid{}, tiles{tileCacheSize},
+   zoom{1.}, viewX{0.}, viewY{0.}, panPoint{wxDefaultPosition},
    defaultPen{}, defaultBrush{},
    trackVisualsMap{},
+   segmentGrid{}, nextTrackId{0}, hoveredKey{},
+   pathClientSize{}, pathBitmapSize{}, pathZoom{1.},
    focusedIndex{0}
 {
    //defaultColor = colorPool.getColor();
@@ -38,12 +87,19 @@ TrackPanel::TrackPanel(wxWindow* parent, wxWindowID id, const wxPoint& pos,
    ///
    Bind(wxEVT_PAINT, &TrackPanel::onPaint, this);
 
-   // call wxWindow::Refresh()
-   Bind(wxEVT_SIZE, std::bind(&TrackPanel::Refresh, this, false, nullptr));
+   Bind(wxEVT_SIZE, &TrackPanel::onSize, this);
 
    Bind(wxEVT_LEFT_DOWN, &TrackPanel::onLeftDown, this);
    Bind(wxEVT_MOUSE_CAPTURE_LOST, &TrackPanel::onCaptureLost, this);
 
+   // Handlers bound later take precedence, so this one only gets the events onMotion()
+   // and onPanMotion() don't handle.
+   Bind(wxEVT_MOTION, &TrackPanel::onHover, this);
+   Bind(wxEVT_LEAVE_WINDOW, &TrackPanel::onLeave, this);
+
+   Bind(wxEVT_MOUSEWHEEL, &TrackPanel::onMouseWheel, this);
+   Bind(wxEVT_MIDDLE_DOWN, &TrackPanel::onMiddleDown, this);
+
    Bind(wxEVT_CONTEXT_MENU, &TrackPanel::onContextMenu, this);
    ///
    //// </_event_handler_mappings_> ////
@@ -58,12 +114,25 @@ void TrackPanel::reset()
       colorPool.returnColor(drawingTools.color);
    }
    trackVisualsMap.clear();
+   segmentGrid.clear();
+   hoveredKey.clear();
    useDrawingToolsOf();
    focusIndex(0);
+   resetView();
 }
 
 void TrackPanel::setBitmap(const wxBitmap& newBitmap)
 {
+   if (!newBitmap.IsSameAs(bitmap))
+   {
+      scaledBitmap = wxGraphicsBitmap{};
+      scaledImage = wxImage{};
+      pyramid.reset();
+      tiles.clear();
+      if (newBitmap.GetSize() != bitmap.GetSize()) {
+         resetView();
+      }
+   }
    bitmap = newBitmap; // wxBitmap uses reference counting
 
    wxSizer* sizer = GetContainingSizer();
@@ -78,10 +147,22 @@ void TrackPanel::setBitmap(const wxBitmap& newBitmap)
    // bitmaps actual size).
 }
 
+void TrackPanel::setPyramid(std::shared_ptr<const Pyramid> newPyramid)
+{
+   pyramid = std::move(newPyramid);
+   tiles.clear();
+}
+
+void TrackPanel::setScaledImage(const wxImage& image)
+{
+   scaledImage = image;
+}
+
 void TrackPanel::addTrack(const std::string& key, std::weak_ptr<const Track> track)
 {
    trackVisualsMap.insert(
-      std::make_pair(key, TrackVisuals{DrawingTools{colorPool.getColor()}, track}));
+      std::make_pair(key, TrackVisuals{DrawingTools{colorPool.getColor()}, track,
+         TrackPath{}, nextTrackId++}));
    defaultColor = colorPool.peek();
    defaultPen   = wxPen{*defaultColor};
    defaultBrush = wxBrush{wxColour{defaultColor->Red(), defaultColor->Green(),
@@ -95,7 +176,9 @@ void TrackPanel::eraseTrack(const std::string& key)
    {
       const DrawingTools& drawingTools = std::get<0>(std::get<1>(*it));
       colorPool.returnColor(drawingTools.color);
+      segmentGrid.erase(std::get<3>(std::get<1>(*it)));
       trackVisualsMap.erase(it);
+      if (hoveredKey == key) hoveredKey.clear();
    }
 }
 
@@ -126,12 +209,57 @@ void TrackPanel::focusIndex(std::size_t index)
    focusedIndex = index;
 }
 
+bool TrackPanel::isZoomed() const {
+   return zoom > 1.;
+}
+
+void TrackPanel::resetView()
+{
+   zoom = 1.;
+   viewX = viewY = 0.;
+}
+
 // TODO: use wxGraphicsMatrix for transformations?
-void TrackPanel::draw(wxGraphicsContext* gC)
+void TrackPanel::draw(wxGraphicsContext* gC, bool forExport)
 {
+   const wxSize size = GetClientSize();
+   if (!bitmap.IsOk() || size.GetWidth() <= 0 || size.GetHeight() <= 0) {
+      return;
+   }
+
+   const double scaleX = getScaleX(), scaleY = getScaleY();
+
    // casting to wxDouble; hence parens and not curly braces are used
-   gC->DrawBitmap(bitmap, 0., 0., wxDouble(GetClientSize().GetWidth()),
-      wxDouble(GetClientSize().GetHeight()));
+   if (forExport || (isZoomed() && !pyramid))
+   {
+      // The context clips what's outside the client area.
+      gC->DrawBitmap(bitmap, -viewX * scaleX, -viewY * scaleY,
+         wxDouble(bitmap.GetWidth() * scaleX), wxDouble(bitmap.GetHeight() * scaleY));
+   }
+   else if (isZoomed()) {
+      drawTiles(gC);
+   }
+   else
+   {
+      // Only uploading the scaled image is left to this thread, once per frame and
+      // size; the bitmap belongs to the renderer, which all paint contexts share.
+      if (scaledImage.IsOk() && scaledImage.GetSize() == size)
+      {
+         scaledBitmap = gC->GetRenderer()->CreateBitmapFromImage(scaledImage);
+         scaledSize = size;
+         scaledImage = wxImage{};
+      }
+      if (!scaledBitmap.IsNull() && scaledSize == size)
+      {
+         gC->DrawBitmap(scaledBitmap, 0., 0., wxDouble(size.GetWidth()),
+            wxDouble(size.GetHeight()));
+      }
+      else
+      {
+         gC->DrawBitmap(bitmap, 0., 0., wxDouble(size.GetWidth()),
+            wxDouble(size.GetHeight()));
+      }
+   }
 
    if (rect.GetPosition().IsFullySpecified() && rect.GetSize().IsFullySpecified())
    {
@@ -140,39 +268,100 @@ void TrackPanel::draw(wxGraphicsContext* gC)
       gC->DrawRectangle(rect.GetX(), rect.GetY(), rect.GetWidth(), rect.GetHeight());
    }
 
-   for (auto i : trackVisualsMap) // i is a pair of a key and a trackVisuals tuple
+   // Paths converted for another scale are of no use.
+   if (size != pathClientSize || bitmap.GetSize() != pathBitmapSize || zoom != pathZoom)
    {
-      const TrackVisuals& trackVisuals = std::get<1>(i);
+      for (auto& i : trackVisualsMap) {
+         std::get<2>(std::get<1>(i)) = TrackPath{};
+      }
+      pathClientSize = size;
+      pathBitmapSize = bitmap.GetSize();
+      pathZoom = zoom;
+   }
+
+   // Bring the grid up to date.  While zoomed in, only the blocks of points in view are
+   // drawn (with a margin for the width of the lines); paths of them aren't worth
+   // caching, as they change with the view.
+   for (auto& i : trackVisualsMap)
+   {
+      std::shared_ptr<const Track> track = std::get<1>(std::get<1>(i)).lock();
+      if (track) segmentGrid.update(std::get<3>(std::get<1>(i)), track);
+   }
+   const bool cull = isZoomed() && !forExport;
+   std::vector<SegmentGrid::Block> visible;
+   if (cull)
+   {
+      visible = segmentGrid.query(int(std::floor(viewX)) - 1, int(std::floor(viewY)) - 1,
+         int(viewX + size.GetWidth() / scaleX) + 1,
+         int(viewY + size.GetHeight() / scaleY) + 1);
+   }
+
+   for (auto& i : trackVisualsMap) // i is a pair of a key and a trackVisuals tuple
+   {
+      TrackVisuals& trackVisuals = std::get<1>(i);
       std::shared_ptr<const Track> track = std::get<1>(trackVisuals).lock();
+      if (!track) continue;
 
       //// <_..._> ////
       ///
       {
          wxColour colour{std::get<0>(trackVisuals).pen.GetColour()};
          colour.Set(colour.Red(), colour.Green(), colour.Blue(), 0xc0); // ...
-         gC->SetPen(wxPen{colour});
-
-         wxGraphicsPath path = gC->CreatePath();
-
-         auto it = std::find_if(track->begin(), track->end(),
-            [](const Point& point) -> bool {
-               return point != Point{-1, -1};
-            }
-         );
-
-         while (it != track->end())
+         gC->SetPen(wxPen{colour, !forExport && std::get<0>(i) == hoveredKey ? 3 : 1});
+
+         // While tracking, new points mostly come after the known ones and the cached
+         // path can just be extended.  Export contexts get a path of their own, at full
+         // detail.
+         TrackPath& trackPath = std::get<2>(trackVisuals);
+         updatePoints(trackPath, *track);
+         gC->PushState();
+         gC->Translate(-viewX * scaleX, -viewY * scaleY);
+         if (forExport)
          {
-            path.MoveToPoint(bitmapToDeviceX(it->x), bitmapToDeviceY(it->y));
-
-            while (++it != track->end() && *it != Point{-1, -1}) {
-               path.AddLineToPoint(bitmapToDeviceX(it->x), bitmapToDeviceY(it->y));
-            }
-
-            it = std::find_if(it, track->end(), [](const Point& point) -> bool {
-               return point != Point{-1, -1};
+            wxGraphicsPath path = gC->CreatePath();
+            wxPoint last;
+            appendToPath(path, last, trackPath.points, 0, trackPath.points.size(), false,
+               -1);
+            gC->StrokePath(path);
+         }
+         else if (cull)
+         {
+            // runs of consecutive visible blocks, plus the point ending the last segment
+            const std::uint32_t id = std::get<3>(trackVisuals);
+            auto block = std::lower_bound(visible.begin(), visible.end(), id,
+               [](const SegmentGrid::Block& b, std::uint32_t track) {
+                  return b.track < track;
                }
             );
-         } gC->StrokePath(path);
+            wxGraphicsPath path = gC->CreatePath();
+            wxPoint last;
+            while (block != visible.end() && block->track == id)
+            {
+               const std::size_t from = block->block * Track::blockSize;
+               std::uint32_t lastBlock = block->block;
+               while (++block != visible.end() && block->track == id &&
+                      block->block == lastBlock + 1)
+               {
+                  ++lastBlock;
+               }
+               const std::size_t to = std::min((lastBlock + 1) * Track::blockSize + 1,
+                                               trackPath.points.size());
+               appendToPath(path, last, trackPath.points, from, to, false, 1);
+            }
+            gC->StrokePath(path);
+         }
+         else
+         {
+            if (trackPath.path.IsNull())
+            {
+               trackPath.path = gC->CreatePath();
+               trackPath.pathEnd = 0;
+            }
+            trackPath.pathEnd = appendToPath(trackPath.path, trackPath.pathLast,
+               trackPath.points, trackPath.pathEnd, trackPath.points.size(), true, 1);
+            gC->StrokePath(trackPath.path);
+         }
+         gC->PopState();
       }
       ///
       //// </_..._> ////
@@ -211,6 +400,169 @@ void TrackPanel::draw(wxGraphicsContext* gC)
    }
 }
 
+void TrackPanel::updatePoints(TrackPath& trackPath, const Track& track) const
+{
+   // Read the version first: a point set meanwhile is caught by the next call.
+   const std::uint32_t version = track.getVersion();
+   if (version == trackPath.version) {
+      return;
+   }
+   trackPath.version = version;
+
+   std::size_t firstChange = track.size();
+   if (trackPath.points.size() > track.size()) {
+      trackPath.points.resize(track.size()); // shrunk; whatever was beyond is gone
+      trackPath.path = wxGraphicsPath{};
+   }
+   trackPath.points.resize(track.size(), unknown);
+   trackPath.blockVersions.resize(track.getBlockCount(), 0);
+
+   // Like bitmapToDeviceX() and bitmapToDeviceY() but without the view's offset.
+   const double scaleX = getScaleX(), scaleY = getScaleY();
+
+   for (std::size_t block = 0; block < track.getBlockCount(); ++block)
+   {
+      const std::uint32_t blockVersion = track.getBlockVersion(block);
+      if (blockVersion == trackPath.blockVersions[block]) continue;
+      trackPath.blockVersions[block] = blockVersion;
+
+      const std::size_t end = std::min((block + 1) * Track::blockSize, track.size());
+      for (std::size_t i = block * Track::blockSize; i < end; ++i)
+      {
+         const Point point = track[i];
+         const wxPoint devicePoint = point == Point{-1, -1} ? unknown :
+            wxPoint{int(std::round((point.x + .5) * scaleX)),
+                    int(std::round((point.y + .5) * scaleY))};
+         if (devicePoint != trackPath.points[i])
+         {
+            trackPath.points[i] = devicePoint;
+            firstChange = std::min(firstChange, i);
+         }
+      }
+   }
+
+   // The path can only be extended by points after the ones it covers.
+   if (firstChange < trackPath.pathEnd) {
+      trackPath.path = wxGraphicsPath{};
+   }
+}
+
+bool TrackPanel::hitTest(const wxPoint& position, std::string& key,
+   std::size_t& index) const
+{
+   if (!bitmap.IsOk() || GetClientSize().GetWidth() <= 0 ||
+       GetClientSize().GetHeight() <= 0)
+   {
+      return false;
+   }
+
+   const double scaleX = getScaleX(), scaleY = getScaleY();
+   SegmentGrid::Hit hit;
+   if (!segmentGrid.hitTest(position.x / scaleX + viewX - .5,
+          position.y / scaleY + viewY - .5, pickDistance / std::min(scaleX, scaleY), hit))
+   {
+      return false;
+   }
+
+   for (const auto& i : trackVisualsMap)
+   {
+      if (std::get<3>(std::get<1>(i)) == hit.track)
+      {
+         key = std::get<0>(i);
+         index = hit.index;
+         return true;
+      }
+   }
+   return false;
+}
+
+double TrackPanel::getScaleX() const {
+   return GetClientSize().GetWidth() * zoom / bitmap.GetWidth();
+}
+
+double TrackPanel::getScaleY() const {
+   return GetClientSize().GetHeight() * zoom / bitmap.GetHeight();
+}
+
+void TrackPanel::clampView()
+{
+   // A zoom of z shows 1 / z of the bitmap in each direction.
+   viewX = std::min(std::max(viewX, 0.), bitmap.GetWidth() * (1. - 1. / zoom));
+   viewY = std::min(std::max(viewY, 0.), bitmap.GetHeight() * (1. - 1. / zoom));
+}
+
+void TrackPanel::drawTiles(wxGraphicsContext* gC)
+{
+   const double scaleX = getScaleX(), scaleY = getScaleY();
+
+   // Take the coarsest level whose pixels are no larger than a device pixel, so none
+   // of the detail shown is lost and no more of it is uploaded than can be shown.
+   std::size_t level = 0;
+   while (level + 1 < pyramid->getLevelCount() &&
+          std::min(scaleX, scaleY) * double(std::size_t{2} << level) <= 1.)
+   {
+      ++level;
+   }
+
+   // bitmap pixels per tile of the level
+   const double tileSpan = double(Pyramid::tileSize << level);
+
+   const wxSize size = GetClientSize();
+   const std::size_t firstColumn = std::size_t(viewX / tileSpan),
+      firstRow = std::size_t(viewY / tileSpan),
+      lastColumn = std::min(pyramid->getColumns(level) - 1,
+         std::size_t((viewX + size.GetWidth() / scaleX) / tileSpan)),
+      lastRow = std::min(pyramid->getRows(level) - 1,
+         std::size_t((viewY + size.GetHeight() / scaleY) / tileSpan));
+
+   // Keep the visible tiles and a ring around them, so neither repaints nor small pans
+   // upload tiles again.
+   tiles.setCapacity(std::max(tileCacheSize,
+      (lastColumn - firstColumn + 3) * (lastRow - firstRow + 3)));
+
+   const Bitmap& source = pyramid->getLevel(level);
+   for (std::size_t row = firstRow; row <= lastRow; ++row)
+   {
+      for (std::size_t column = firstColumn; column <= lastColumn; ++column)
+      {
+         // Round the edges, so neighbouring tiles neither overlap nor leave gaps.
+         const double right = std::min((column + 1) * Pyramid::tileSize, source.width),
+            bottom = std::min((row + 1) * Pyramid::tileSize, source.height);
+         const double left = std::round((column * tileSpan - viewX) * scaleX),
+            top = std::round((row * tileSpan - viewY) * scaleY);
+         const double width = std::round(
+            (right * double(std::size_t{1} << level) - viewX) * scaleX) - left;
+         const double height = std::round(
+            (bottom * double(std::size_t{1} << level) - viewY) * scaleY) - top;
+         gC->DrawBitmap(getTile(gC, level, column, row), left, top, width, height);
+      }
+   }
+}
+
+wxGraphicsBitmap TrackPanel::getTile(wxGraphicsContext* gC, std::size_t level,
+   std::size_t column, std::size_t row)
+{
+   const std::uint64_t key =
+      std::uint64_t{level} << 48 | std::uint64_t{row} << 24 | std::uint64_t{column};
+   wxGraphicsBitmap tile;
+   if (tiles.get(key, tile)) {
+      return tile;
+   }
+
+   const Bitmap& source = pyramid->getLevel(level);
+   const std::size_t x = column * Pyramid::tileSize, y = row * Pyramid::tileSize;
+   const std::size_t width = std::min(Pyramid::tileSize, source.width - x),
+      height = std::min(Pyramid::tileSize, source.height - y);
+
+   wxImage image{int(width), int(height), false};
+   for (std::size_t i = 0; i < height; ++i) {
+      expandGray(source[y + i] + x, width, image.GetData() + i * width * 3, 3);
+   }
+   tile = gC->GetRenderer()->CreateBitmapFromImage(image);
+   tiles.put(key, tile);
+   return tile;
+}
+
 //// <_event_handler_definitions_> ////
 ///
 void TrackPanel::onPaint(wxPaintEvent&)
@@ -231,9 +583,35 @@ void TrackPanel::onPaint(wxPaintEvent&)
    }
 }
 
+void TrackPanel::onSize(wxSizeEvent&)
+{
+   wxCommandEvent newEvent{myEVT_TRACKPANEL_RESIZED, GetId()};
+   newEvent.SetEventObject(this);
+   GetEventHandler()->ProcessEvent(newEvent);
+
+   Refresh(false);
+}
+
 void TrackPanel::onLeftDown(wxMouseEvent& event)
 {
-   assert (!HasCapture());
+   if (HasCapture()) // while panning
+   {
+      event.Skip();
+      return;
+   }
+
+   std::string key;
+   std::size_t index;
+   if (event.CmdDown() && hitTest(event.GetPosition(), key, index))
+   {
+      wxCommandEvent newEvent{myEVT_TRACKPANEL_PICKED, GetId()};
+      newEvent.SetEventObject(this);
+      newEvent.SetString(key);
+      newEvent.SetInt(int(index));
+      GetEventHandler()->ProcessEvent(newEvent);
+      event.Skip();
+      return;
+   }
 
    CaptureMouse();
 
@@ -252,6 +630,16 @@ void TrackPanel::onCaptureLost(wxMouseCaptureLostEvent&)
 {
    assert (!HasCapture());
 
+   if (panPoint != wxDefaultPosition)
+   {
+      bool didUnbind = Unbind(wxEVT_MOTION, &TrackPanel::onPanMotion, this) &&
+                       Unbind(wxEVT_MIDDLE_UP, &TrackPanel::onMiddleUp, this);
+      assert (didUnbind);
+
+      panPoint = wxDefaultPosition;
+      return;
+   }
+
    bool didUnbind = Unbind(wxEVT_MOTION, &TrackPanel::onMotion, this) &&
                     Unbind(wxEVT_LEFT_UP, &TrackPanel::onLeftUp, this);
    assert (didUnbind);
@@ -303,15 +691,10 @@ void TrackPanel::onLeftUp(wxMouseEvent&)
 
    //// <_..._> ////
    ///
-   // convert rect to bitmap coordinates
-   rect.x      = deviceToBitmapX(rect.x);
-   rect.y      = deviceToBitmapY(rect.y);
-   rect.width  = deviceToBitmapX(rect.width);
-   rect.height = deviceToBitmapY(rect.height);
-
-   // disallow empty rects
-   if (rect.width == 0) rect.width = 1;
-   if (rect.height == 0) rect.height = 1;
+   // convert rect to bitmap coordinates; it covers at least one pixel
+   rect = wxRect{wxPoint{deviceToBitmapX(rect.GetLeft()), deviceToBitmapY(rect.GetTop())},
+      wxPoint{deviceToBitmapX(rect.GetRight()), deviceToBitmapY(rect.GetBottom())}};
+   rect.Intersect(wxRect{bitmap.GetSize()});
 
    int centerX = rect.GetX() + rect.GetWidth() / 2;
    int centerY = rect.GetY() + rect.GetHeight() / 2;
@@ -368,6 +751,97 @@ void TrackPanel::onLeftUp(wxMouseEvent&)
    Refresh(false);
 }
 
+void TrackPanel::onHover(wxMouseEvent& event)
+{
+   std::string key;
+   std::size_t index;
+   if (!hitTest(event.GetPosition(), key, index)) {
+      key.clear();
+   }
+   if (key != hoveredKey)
+   {
+      hoveredKey = key;
+      Refresh(false);
+   }
+   event.Skip();
+}
+
+void TrackPanel::onLeave(wxMouseEvent& event)
+{
+   if (!hoveredKey.empty())
+   {
+      hoveredKey.clear();
+      Refresh(false);
+   }
+   event.Skip();
+}
+
+void TrackPanel::onMouseWheel(wxMouseEvent& event)
+{
+   if (HasCapture() || !bitmap.IsOk() || !event.GetWheelDelta() ||
+       event.GetWheelAxis() != wxMOUSE_WHEEL_VERTICAL)
+   {
+      event.Skip();
+      return;
+   }
+
+   // Keep the bitmap point under the mouse where it is.
+   const double x = event.GetX() / getScaleX() + viewX,
+                y = event.GetY() / getScaleY() + viewY;
+
+   const bool wasZoomed = isZoomed();
+   zoom *= std::pow(zoomStep, double(event.GetWheelRotation()) / event.GetWheelDelta());
+   zoom = std::min(std::max(zoom, 1.), maxZoom);
+
+   viewX = x - event.GetX() / getScaleX();
+   viewY = y - event.GetY() / getScaleY();
+   clampView();
+
+   if (!wasZoomed && isZoomed())
+   {
+      wxCommandEvent newEvent{myEVT_TRACKPANEL_ZOOMED, GetId()};
+      newEvent.SetEventObject(this);
+      GetEventHandler()->ProcessEvent(newEvent);
+   }
+   Refresh(false);
+}
+
+void TrackPanel::onMiddleDown(wxMouseEvent& event)
+{
+   if (!HasCapture() && isZoomed())
+   {
+      CaptureMouse();
+      panPoint = event.GetPosition();
+      Bind(wxEVT_MOTION, &TrackPanel::onPanMotion, this);
+      Bind(wxEVT_MIDDLE_UP, &TrackPanel::onMiddleUp, this);
+   }
+   event.Skip();
+}
+
+void TrackPanel::onPanMotion(wxMouseEvent& event)
+{
+   // As with onMotion(), the handler for wxEVT_MOUSE_CAPTURE_LOST unbinds this one.
+   assert (HasCapture());
+
+   viewX -= (event.GetX() - panPoint.x) / getScaleX();
+   viewY -= (event.GetY() - panPoint.y) / getScaleY();
+   panPoint = event.GetPosition();
+   clampView();
+   Refresh(false);
+}
+
+void TrackPanel::onMiddleUp(wxMouseEvent&)
+{
+   assert (HasCapture());
+
+   bool didUnbind = Unbind(wxEVT_MOTION, &TrackPanel::onPanMotion, this) &&
+                    Unbind(wxEVT_MIDDLE_UP, &TrackPanel::onMiddleUp, this);
+   assert (didUnbind);
+
+   panPoint = wxDefaultPosition;
+   ReleaseMouse();
+}
+
 void TrackPanel::onContextMenu(wxContextMenuEvent&)
 {
    wxMenu menu{};
@@ -390,26 +864,22 @@ void TrackPanel::onSave(wxCommandEvent&)
 wxCoord TrackPanel::bitmapToDeviceX(wxCoord bitmapX) const
 {
    // casting to double; curly braces would cause an implicit, narrowing conversion (bad)
-   return std::round(double(bitmapX * GetClientSize().GetWidth()) /
-                     double(bitmap.GetWidth()));
+   return std::round((double(bitmapX) + .5 - viewX) * getScaleX());
 }
 
 wxCoord TrackPanel::bitmapToDeviceY(wxCoord bitmapY) const
 {
-   return std::round(double(bitmapY * GetClientSize().GetHeight()) /
-                     double(bitmap.GetHeight()));
+   return std::round((double(bitmapY) + .5 - viewY) * getScaleY());
 }
 
 wxCoord TrackPanel::deviceToBitmapX(wxCoord deviceX) const
 {
-   return std::round(double(deviceX * bitmap.GetWidth()) /
-                     double(GetClientSize().GetWidth()));
+   return std::floor(double(deviceX) / getScaleX() + viewX);
 }
 
 wxCoord TrackPanel::deviceToBitmapY(wxCoord deviceY) const
 {
-   return std::round(double(deviceY * bitmap.GetHeight()) /
-                     double(GetClientSize().GetHeight()));
+   return std::floor(double(deviceY) / getScaleY() + viewY);
 }
 ///
 //// </_coordinate_conversion_functions_> ////
@@ -428,3 +898,6 @@ bool TrackPanel::AcceptsFocusFromKeyboard() const {
 
 wxDEFINE_EVENT(myEVT_TRACKPANEL_MARKED, TrackPanelEvent);
 wxDEFINE_EVENT(myEVT_TRACKPANEL_SAVE, wxCommandEvent);
+wxDEFINE_EVENT(myEVT_TRACKPANEL_ZOOMED, wxCommandEvent);
+wxDEFINE_EVENT(myEVT_TRACKPANEL_RESIZED, wxCommandEvent);
+wxDEFINE_EVENT(myEVT_TRACKPANEL_PICKED, wxCommandEvent);
@@ -2,20 +2,26 @@
 #define TRACK_PANEL_H
 
 #include <cstddef> // size_t
+#include <cstdint> // uint32_t
 #include <map>
-#include <memory> // weak_ptr
+#include <memory> // shared_ptr, weak_ptr
 #include <string>
 #include <tuple>
+#include <vector>
 
 #include <wx/bitmap.h> // wxBitmap
 #include <wx/brush.h>
 #include <wx/event.h> // wxPaintEvent, wxMouseEvent
 #include <wx/gdicmn.h> // wxPoint, wxRect
 #include <wx/graphics.h>
+#include <wx/image.h> // wxImage
 #include <wx/panel.h>
 #include <wx/pen.h>
 
 #include "color_pool.hpp"
+#include "lru_cache.hpp"
+#include "pyramid.hpp"
+#include "segment_grid.hpp"
 #include "track.hpp" // conrete type Track used by the back end to model trajectories
 
 struct DrawingTools {
@@ -29,7 +35,21 @@ struct DrawingTools {
    wxBrush         brush;
 };
 
-typedef std::tuple<DrawingTools, std::weak_ptr<const Track>> TrackVisuals;
+// A track in device coordinates, kept up to date block by block as the track changes.
+struct TrackPath
+{
+   std::uint32_t              version = 0;   // of the track when last updated; 0: never
+   std::vector<std::uint32_t> blockVersions; // ditto, of each block of the track
+   std::vector<wxPoint>       points;        // {-1, -1} where unknown
+   wxGraphicsPath             path;          // of points[0, pathEnd), simplified to
+                                             // the pixels they cover; may be null
+   std::size_t                pathEnd = 0;   // one past the last known point in path
+   wxPoint                    pathLast;      // last point added to path
+};
+
+// The last element is the id of the track in the SegmentGrid.
+typedef std::tuple<DrawingTools, std::weak_ptr<const Track>, TrackPath, std::uint32_t>
+   TrackVisuals;
 
 class TrackPanelEvent; // derived from wxEvent; propagated upwards like command events
 
@@ -38,6 +58,16 @@ class TrackPanelEvent; // derived from wxEvent; propagated upwards like command
 wxDECLARE_EVENT(myEVT_TRACKPANEL_MARKED, TrackPanelEvent);
 wxDECLARE_EVENT(myEVT_TRACKPANEL_SAVE, wxCommandEvent);
 
+// generated when the user zoomed in from the whole frame; the frame's Pyramid is wanted
+wxDECLARE_EVENT(myEVT_TRACKPANEL_ZOOMED, wxCommandEvent);
+
+// generated when the client size changed; the frame scaled to it is wanted
+wxDECLARE_EVENT(myEVT_TRACKPANEL_RESIZED, wxCommandEvent);
+
+// generated when the user Ctrl+clicked a track; the string is its key and the int the
+// index of the frame of the point nearest to where it was clicked
+wxDECLARE_EVENT(myEVT_TRACKPANEL_PICKED, wxCommandEvent);
+
 // Events emitted by this class:
 //    custom event of type TrackPanelEvent with Id myEVT_TRACKPANEL_MARKED; no event macro
 class TrackPanel : public wxPanel
@@ -49,8 +79,18 @@ class TrackPanel : public wxPanel
 
    void reset();
 
+   // A bitmap of another size than the last one is shown as a whole.
    void setBitmap(const wxBitmap&);
 
+   // The pyramid of the current bitmap, used to draw only what's visible while zoomed
+   // in; dropped with the bitmap.  Until there is one, the whole bitmap is drawn.
+   void setPyramid(std::shared_ptr<const Pyramid>);
+
+   // The current bitmap scaled to the client size off the UI thread (see FramePreparer);
+   // dropped with the bitmap.  Until there is one for the current size, the paint
+   // context scales the bitmap.
+   void setScaledImage(const wxImage&);
+
    void addTrack(const std::string& key, std::weak_ptr<const Track>);
    void eraseTrack(const std::string& key);
 
@@ -60,9 +100,18 @@ class TrackPanel : public wxPanel
 
    void focusIndex(std::size_t); // ...
 
-   void draw(wxGraphicsContext*);
+   // Draw the frame, scaled to the client size, and the tracks on top.  The scaled image
+   // is uploaded once for the paint contexts of this panel; pass forExport for other
+   // contexts, e.g. of a wxMemoryDC, which may not be able to use it.
+   void draw(wxGraphicsContext*, bool forExport = false);
+
+   // The user zooms with the mouse wheel (towards the pointer) and pans by dragging with
+   // the middle button.  Zoom 1 shows the whole bitmap.
+   bool isZoomed() const;
+   void resetView();
 
-   // coordinate converion functions
+   // coordinate converion functions; bitmap pixels map to the device coordinates of their
+   // centers and back
    wxCoord bitmapToDeviceX(wxCoord) const;
    wxCoord bitmapToDeviceY(wxCoord) const;
    wxCoord deviceToBitmapX(wxCoord) const;
@@ -84,13 +133,56 @@ class TrackPanel : public wxPanel
                                                  // handling this event is mandatory for
                                                  // an application that captures the mouse
    void onMotion(wxMouseEvent&);                 // process a wxEVT_MOTION
+   void onHover(wxMouseEvent&);                  // process a wxEVT_MOTION while the
+                                                 // mouse isn't captured
+   void onLeave(wxMouseEvent&);                  // process a wxEVT_LEAVE_WINDOW
    void onLeftUp(wxMouseEvent&);                 // process a wxEVT_LEFT_UP
 
+   void onMouseWheel(wxMouseEvent&);             // process a wxEVT_MOUSEWHEEL
+   void onMiddleDown(wxMouseEvent&);             // process a wxEVT_MIDDLE_DOWN; captures
+                                                 // the mouse
+   void onPanMotion(wxMouseEvent&);              // process a wxEVT_MOTION while panning
+   void onMiddleUp(wxMouseEvent&);               // process a wxEVT_MIDDLE_UP
+
    void onContextMenu(wxContextMenuEvent&);      // process a wxEVT_CONTEXT_MENU
    void onSave(wxCommandEvent&);                 // process a wxEVT_COMMAND_MENU_SELECTED
 
+   // Convert the points of the blocks of the track that changed since the last call.
+   // The path is dropped if any point it covers changed; it can be extended otherwise.
+   void updatePoints(TrackPath&, const Track&) const;
+
+   // The track passing nearest to a position, if any passes close enough; the index is
+   // that of its point nearest to the position.
+   bool hitTest(const wxPoint&, std::string& key, std::size_t& index) const;
+
+   // device pixels per bitmap pixel
+   double getScaleX() const;
+   double getScaleY() const;
+
+   // Keep the view within the bitmap.
+   void clampView();
+
+   // Draw the tiles of the pyramid level fitting the scale that intersect the view.
+   void drawTiles(wxGraphicsContext*);
+   wxGraphicsBitmap getTile(wxGraphicsContext*, std::size_t level, std::size_t column,
+                            std::size_t row);
+
    wxBitmap bitmap; // platform-dependant bitmap
 
+   // bitmap scaled to scaledSize, so repaints that only change what's drawn on top of it
+   // just draw it; null after the frame changed
+   wxGraphicsBitmap scaledBitmap;
+   wxSize           scaledSize;
+   wxImage          scaledImage; // to be uploaded to scaledBitmap; may be null
+
+   std::shared_ptr<const Pyramid> pyramid; // of bitmap; may be nullptr
+   LruCache<std::uint64_t, wxGraphicsBitmap> tiles; // of pyramid, uploaded when visible
+
+   double  zoom;         // relative to showing the whole bitmap
+   double  viewX, viewY; // bitmap coordinates of the top left corner of the client area
+   wxPoint panPoint;     // last position of the mouse while panning; otherwise
+                         // wxDefaultPosition
+
    ColorPool colorPool;
 
    // used when drawing anything other than TrackVisuals
@@ -102,6 +194,18 @@ class TrackPanel : public wxPanel
    // removed and its color is returned to the ColorPool.
    std::map<std::string, TrackVisuals> trackVisualsMap;
 
+   // over all tracks, updated when they're drawn; used to draw only the blocks of points
+   // in view while zoomed in and to find the track under the mouse
+   SegmentGrid segmentGrid;
+   std::uint32_t nextTrackId;
+
+   std::string hoveredKey; // of the track under the mouse, drawn wider; may be empty
+
+   // the sizes and zoom the cached TrackPaths were converted for; they are translated
+   // for the view when drawn
+   wxSize pathClientSize, pathBitmapSize;
+   double pathZoom;
+
    std::size_t focusedIndex; // ...
 
    wxPoint leftDownPoint; // stores the position of the mouse fetched from within a
@@ -23,6 +23,9 @@ class Trackee
 
    void setPoint(std::size_t index, const Point&);
 
+   // Extend the track to more frames (with unknown points); not while it's being tracked.
+   void resize(std::size_t frameCount);
+
    std::weak_ptr<const Track> getTrack() const;
 
    private:
@@ -33,7 +36,12 @@ class Trackee
 
 inline void Trackee::setPoint(std::size_t index, const Point& point)
 {
-   (*track)[index] = point;
+   track->set(index, point);
+}
+
+inline void Trackee::resize(std::size_t frameCount)
+{
+   track->resize(frameCount, Point{-1, -1});
 }
 
 inline std::weak_ptr<const Track> Trackee::getTrack() const
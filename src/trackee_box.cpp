@@ -125,6 +125,22 @@ void TrackeeBox::deleteSelection()
    }
 }
 
+bool TrackeeBox::selectTrackee(const std::string& key)
+{
+   auto position = listBox->FindString(key, true); // case-sensitive
+   if (position == wxNOT_FOUND) {
+      return false;
+   }
+
+   listBox->SetSelection(position);
+   wxCommandEvent newEvent{wxEVT_COMMAND_LISTBOX_SELECTED, listBox->GetId()};
+   newEvent.SetEventObject(listBox);
+   newEvent.SetInt(position);
+   newEvent.SetString(listBox->GetString(position));
+   GetEventHandler()->ProcessEvent(newEvent);
+   return true;
+}
+
 void TrackeeBox::reset()
 {
    listBox->Clear();
@@ -30,6 +30,10 @@ class TrackeeBox : public wxPanel
 
    void deleteSelection();
 
+   // Select a trackee and generate a selection event as if the user had clicked it; false
+   // if there is no trackee by that key.
+   bool selectTrackee(const std::string& key);
+
    void reset();
 
    wxString getStringSelection() const;
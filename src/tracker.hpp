@@ -1,12 +1,14 @@
 #ifndef TRACKER_H
 #define TRACKER_H
 
-#include <algorithm> // find(), find_if()
+#include <algorithm> // find(), find_if(), min()
 #include <cmath>     // pow()
-#include <cstddef>   // size_t
-#include <memory>    // shared_ptr
+#include <cstddef>   // size_t, ptrdiff_t
+#include <memory>    // shared_ptr, unique_ptr
+#include <vector>
 
 #include "movie.hpp"   // defines Frame
+#include "read_ahead.hpp"
 #include "trackee.hpp"
 
 class Tracker
@@ -18,8 +20,27 @@ class Tracker
 
    void track(Trackee&, const Movie&);
 
+   // Track the frames from index from to the end forwards from the point of the frame
+   // before it, leaving the rest of the track as it is; for the new frames of movies that
+   // are still being recorded.  Does nothing unless that point is known.
+   void trackOn(Trackee&, const Movie&, std::size_t from);
+
+   // The indices of the frames track(Trackee&, const Movie&) will visit, in the order it
+   // visits them: backwards from the first known point, then alternating from both ends
+   // of each gap between known points, and forwards from the last known point.  If
+   // adjacent is given, it receives the neighbouring frame each one is tracked from.
+   static std::vector<std::size_t> visitingOrder(const Track&,
+      std::vector<std::size_t>* adjacent = nullptr);
+
    private:
 
+   // Read the frames of order ahead of the tracker: in bands of rows around the trackee
+   // if the source can read them and they are a small part of the frame, or whole.
+   // adjacent holds the neighbouring frame each one is tracked from.
+   static std::unique_ptr<ReadAhead> readAhead(const Trackee&, const Movie&,
+      std::vector<std::size_t> order, std::vector<std::size_t> adjacent);
+
+   // Without a bitmap, both return adjacentPoint.
    Point trackDown(Trackee&, std::shared_ptr<const Bitmap>, const Point& adjacentPoint);
 
    // The last parameter denotes the auxiliaryPoint's distance (in frames) to the Bitmap.
@@ -50,11 +71,25 @@ inline void Tracker::track(Trackee& trackee, const Movie& movie)
    );
    if (last != track->end())
    {
+      // Loader threads read ahead of the loops below.
+      std::vector<std::size_t> adjacent;
+      std::vector<std::size_t> order = visitingOrder(*track, &adjacent);
+      std::unique_ptr<ReadAhead> frames = readAhead(trackee, movie, std::move(order),
+                                                    std::move(adjacent));
+      // The rows end at the bottom like the bands read ahead, so those bands are used.
+      const std::size_t height = movie.getFrameHeight();
+      auto next = [&](std::size_t index, const Point& adjacentPoint) {
+         const std::size_t y = adjacentPoint.y, speedCap = trackee.speedCap;
+         return frames->next(index, y > speedCap ? y - speedCap : 0,
+                             std::min(y + speedCap + 1, height));
+      };
+
       auto first = std::find(track->begin(), last, Point{-1, -1});
       for (auto i = last; i != first;)
       {
-         --i; *i = trackDown(trackee, movie.getFrame(i - track->begin()).getBitmap(),
-            *(i + 1));
+         --i;
+         track->set(i - track->begin(),
+            trackDown(trackee, next(i - track->begin(), *(i + 1)), *(i + 1)));
       }
 
       first = std::find(last, track->end(), Point{-1, -1});
@@ -67,13 +102,14 @@ inline void Tracker::track(Trackee& trackee, const Movie& movie)
          auto i = last;
          while (first != i)
          {
-            *first = trackDown(trackee, movie.getFrame(
-               first - track->begin()).getBitmap(), *(first - 1), *i, i - first);
+            track->set(first - track->begin(), trackDown(trackee,
+               next(first - track->begin(), *(first - 1)), *(first - 1), *i, i - first));
             ++first;
             if (first != i) {
                --i;
-               *i = trackDown(trackee, movie.getFrame(i - track->begin()).getBitmap(),
-                  *(i + 1), *(first - 1), i - first + 1);
+               track->set(i - track->begin(), trackDown(trackee,
+                  next(i - track->begin(), *(i + 1)), *(i + 1), *(first - 1),
+                  i - first + 1));
             }
             else {
                break;
@@ -87,15 +123,133 @@ inline void Tracker::track(Trackee& trackee, const Movie& movie)
       }
       for (;first != last; ++first)
       {
-         *first = trackDown(trackee, movie.getFrame(first - track->begin()).getBitmap(),
-            *(first - 1));
+         track->set(first - track->begin(), trackDown(trackee,
+            next(first - track->begin(), *(first - 1)), *(first - 1)));
       }
    }
 }
 
+inline void Tracker::trackOn(Trackee& trackee, const Movie& movie, std::size_t from)
+{
+   std::shared_ptr<Track> track = trackee.track;
+   const std::size_t size = track->size();
+   if (!from || from >= size || (*track)[from - 1] == Point{-1, -1}) {
+      return;
+   }
+
+   std::vector<std::size_t> order, adjacent;
+   for (std::size_t i = from; i != size; ++i)
+   {
+      order.push_back(i);
+      adjacent.push_back(i - 1);
+   }
+   std::unique_ptr<ReadAhead> frames = readAhead(trackee, movie, std::move(order),
+                                                 std::move(adjacent));
+   const std::size_t height = movie.getFrameHeight();
+   for (std::size_t i = from; i != size; ++i)
+   {
+      const Point adjacentPoint = (*track)[i - 1];
+      const std::size_t y = adjacentPoint.y, speedCap = trackee.speedCap;
+      track->set(i, trackDown(trackee, frames->next(i, y > speedCap ? y - speedCap : 0,
+                                                    std::min(y + speedCap + 1, height)),
+         adjacentPoint));
+   }
+}
+
+inline std::vector<std::size_t> Tracker::visitingOrder(const Track& track,
+   std::vector<std::size_t>* adjacent)
+{
+   // Mirrors the loops of track(Trackee&, const Movie&) without doing any tracking.
+   std::vector<std::size_t> order;
+   auto visit = [&](std::size_t index, std::size_t from) {
+      order.push_back(index);
+      if (adjacent) adjacent->push_back(from);
+   };
+   const std::size_t size = track.size();
+   auto isKnown = [&track](std::size_t i) { return track[i] != Point{-1, -1}; };
+
+   std::size_t last = 0;
+   while (last != size && !isKnown(last)) ++last;
+   if (last == size) return order;
+
+   for (std::size_t i = last; i != 0; --i) {
+      visit(i - 1, i);
+   }
+
+   std::size_t first = last;
+   while (first != size && isKnown(first)) ++first;
+   last = first;
+   while (last != size && !isKnown(last)) ++last;
+   while (last != size)
+   {
+      std::size_t i = last;
+      while (first != i)
+      {
+         visit(first, first - 1);
+         ++first;
+         if (first != i) {
+            --i;
+            visit(i, i + 1);
+         }
+         else {
+            break;
+         }
+      }
+      first = last;
+      while (first != size && isKnown(first)) ++first;
+      last = first;
+      while (last != size && !isKnown(last)) ++last;
+   }
+   for (; first != last; ++first) {
+      visit(first, first - 1);
+   }
+
+   return order;
+}
+
+inline std::unique_ptr<ReadAhead> Tracker::readAhead(const Trackee& trackee,
+   const Movie& movie, std::vector<std::size_t> order, std::vector<std::size_t> adjacent)
+{
+   // The height comes from the source, so no frame has to be decoded to learn it.
+   const std::size_t height = movie.getFrameHeight(), speedCap = trackee.speedCap;
+   if (!movie.hasRowAccess() || !height || 4 * (2 * speedCap + 1) > height) {
+      return std::unique_ptr<ReadAhead>{new ReadAhead{movie, std::move(order)}};
+   }
+
+   // The trackee moves speedCap pixels per frame at most, so in a frame ahead it is
+   // within steps * speedCap rows of the nearest point known by then along the frames it
+   // is tracked from.  The band of a frame is requested when the frame enters the window;
+   // a short window keeps it narrow.  Frames whose band would be too wide are read whole.
+   std::shared_ptr<const Track> track = trackee.track;
+   const std::vector<std::size_t> indices = order;
+   auto band = [track, indices, adjacent, height, speedCap](std::size_t position,
+      std::size_t& first, std::size_t& last)
+   {
+      const std::ptrdiff_t step =
+         std::ptrdiff_t(adjacent[position]) - std::ptrdiff_t(indices[position]);
+      std::size_t from = adjacent[position], steps = 1;
+      while ((*track)[from] == Point{-1, -1})
+      {
+         if (4 * (2 * (steps + 1) * speedCap + 1) > height) return false;
+         from += step;
+         ++steps;
+      }
+      const std::size_t y = (*track)[from].y, reach = steps * speedCap;
+      first = y > reach ? y - reach : 0;
+      last = std::min(y + reach + 1, height);
+      return true;
+   };
+   return std::unique_ptr<ReadAhead>{new ReadAhead{movie, std::move(order), band, 4}};
+}
+
 inline Point Tracker::trackDown(Trackee& trackee, std::shared_ptr<const Bitmap> bitmap,
    const Point& adjacentPoint)
 {
+   // A frame that couldn't be decoded, e.g. one still being written, doesn't move it.
+   if (!bitmap) {
+      return adjacentPoint;
+   }
+
    int firstRow    = unsigned(adjacentPoint.y) < trackee.speedCap ?
                         0 : adjacentPoint.y - trackee.speedCap;
    int lastRow     = adjacentPoint.y + trackee.speedCap < bitmap->height ?
@@ -138,6 +292,10 @@ inline Point Tracker::trackDown(Trackee& trackee, std::shared_ptr<const Bitmap>
 inline Point Tracker::trackDown(Trackee& trackee, std::shared_ptr<const Bitmap> bitmap,
    const Point& adjacentPoint, const Point& auxiliaryPoint, unsigned proximity)
 {
+   if (!bitmap) {
+      return adjacentPoint;
+   }
+
    int firstRow    = unsigned(adjacentPoint.y) < trackee.speedCap ?
                         0 : adjacentPoint.y - trackee.speedCap;
    int lastRow     = adjacentPoint.y + trackee.speedCap < bitmap->height ?